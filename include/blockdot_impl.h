@@ -0,0 +1,207 @@
+#ifndef PETSCVECTOR_BLOCKDOT_IMPL_H
+#define	PETSCVECTOR_BLOCKDOT_IMPL_H
+
+namespace petscvector {
+
+/* local products of all pairs, the blocks of all arrays stay in cache while they are multiplied;
+ * in symmetric case (x == y) only the upper triangle is computed */
+void block_dot_local_petscvector(int k, const PetscScalar * const *x, int l, const PetscScalar * const *y, int n, bool symmetric, double *result){
+	const PetscScalar *xi, *yj;
+	double value;
+	int i, j, t, begin, end, i_end;
+
+	for(j=0; j < k*l; j++){
+		result[j] = 0.0;
+	}
+
+	for(begin=0; begin < n; begin += PETSCVECTOR_BLOCKSIZE){
+		end = begin + PETSCVECTOR_BLOCKSIZE;
+		if(end > n) end = n;
+
+		for(j=0; j < l; j++){
+			yj = y[j];
+			i_end = symmetric ? j+1 : k;
+			for(i=0; i < i_end; i++){
+				xi = x[i];
+				value = 0.0;
+				for(t=begin; t < end; t++){
+					value += xi[t]*yj[t];
+				}
+				result[i+j*k] += value;
+			}
+		}
+	}
+}
+
+/* sum the upper triangle of symmetric matrix over all processes and copy it to the lower one */
+void reduce_upper_petscvector(int k, double *result, MPI_Comm comm){
+	double *packed;
+	int i, j, m;
+
+	TRY( PetscMalloc1((size_t)k*(k+1)/2, &packed) );
+	m = 0;
+	for(j=0; j < k; j++){
+		for(i=0; i <= j; i++){
+			packed[m++] = result[i+j*k];
+		}
+	}
+
+	TRY( MPI_Allreduce(MPI_IN_PLACE, packed, m, MPIU_SCALAR, MPIU_SUM, comm) );
+
+	m = 0;
+	for(j=0; j < k; j++){
+		for(i=0; i <= j; i++){
+			result[i+j*k] = packed[m];
+			result[j+i*k] = packed[m];
+			m++;
+		}
+	}
+	TRY( PetscFree(packed) );
+}
+
+/* arrays of both groups are read once, one global reduction for all products */
+void block_dot(int k, const PetscVector * const *x, int l, const PetscVector * const *y, double *result){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "block_dot(int,PetscVector**,int,PetscVector**,double*)");
+
+	const PetscScalar **arrays;
+	MPI_Comm comm;
+	int local_size, j;
+
+	if(k <= 0 || l <= 0){
+		return;
+	}
+
+	/* all lengths are checked before any array is taken */
+	local_size = x[0]->local_size();
+	for(j=0; j < k+l; j++){
+		if(((j < k) ? x[j] : y[j-k])->local_size() != local_size){
+			PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+			return;
+		}
+	}
+
+	TRY( PetscMalloc1(k+l, &arrays) );
+	for(j=0; j < k+l; j++){
+		const PetscVector *vec = (j < k) ? x[j] : y[j-k];
+		vec->valuesUpdate();
+		TRY( VecGetArrayRead(vec->inner_vector, &(arrays[j])) );
+	}
+
+	block_dot_local_petscvector(k, arrays, l, arrays + k, local_size, false, result);
+
+	for(j=0; j < k+l; j++){
+		const PetscVector *vec = (j < k) ? x[j] : y[j-k];
+		TRY( VecRestoreArrayRead(vec->inner_vector, &(arrays[j])) );
+	}
+	TRY( PetscFree(arrays) );
+	TRY( PetscLogFlops(2.0*k*l*local_size) );
+
+	TRY( PetscObjectGetComm((PetscObject)(x[0]->inner_vector), &comm) );
+	TRY( MPI_Allreduce(MPI_IN_PLACE, result, k*l, MPIU_SCALAR, MPIU_SUM, comm) );
+}
+
+void gram(int k, const PetscVector * const *x, double *result){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "gram(int,PetscVector**,double*)");
+
+	const PetscScalar **arrays;
+	MPI_Comm comm;
+	int local_size, j;
+
+	if(k <= 0){
+		return;
+	}
+
+	local_size = x[0]->local_size();
+	for(j=0; j < k; j++){
+		if(x[j]->local_size() != local_size){
+			PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+			return;
+		}
+	}
+
+	TRY( PetscMalloc1(k, &arrays) );
+	for(j=0; j < k; j++){
+		x[j]->valuesUpdate();
+		TRY( VecGetArrayRead(x[j]->inner_vector, &(arrays[j])) );
+	}
+
+	block_dot_local_petscvector(k, arrays, k, arrays, local_size, true, result);
+
+	for(j=0; j < k; j++){
+		TRY( VecRestoreArrayRead(x[j]->inner_vector, &(arrays[j])) );
+	}
+	TRY( PetscFree(arrays) );
+	TRY( PetscLogFlops(1.0*k*(k+1)*local_size) );
+
+	TRY( PetscObjectGetComm((PetscObject)(x[0]->inner_vector), &comm) );
+	reduce_upper_petscvector(k, result, comm);
+}
+
+/* columns are stored in one array, the local products are one matrix product X^T*Y */
+void block_dot(const PetscMultiVector &x, const PetscMultiVector &y, double *result){
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "block_dot(MultiVector,MultiVector,double*)");
+
+	PetscBLASInt m, n, p, ldx, ldy;
+	PetscScalar one = 1.0, zero = 0.0;
+	int j;
+
+	if(x.columns_size == 0 || y.columns_size == 0){
+		return;
+	}
+	if(x.local_length != y.local_length){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+		return;
+	}
+
+	x.values_update();
+	y.values_update();
+
+	if(x.local_length > 0){
+		TRY( PetscBLASIntCast(x.columns_size, &m) );
+		TRY( PetscBLASIntCast(y.columns_size, &n) );
+		TRY( PetscBLASIntCast(x.local_length, &p) );
+		TRY( PetscBLASIntCast(x.leading_size, &ldx) );
+		TRY( PetscBLASIntCast(y.leading_size, &ldy) );
+		BLASgemm_("T", "N", &m, &n, &p, &one, x.array, &ldx, y.array, &ldy, &zero, result, &m);
+		TRY( PetscLogFlops(2.0*x.columns_size*y.columns_size*x.local_length) );
+	} else {
+		for(j=0; j < x.columns_size*y.columns_size; j++){
+			result[j] = 0.0;
+		}
+	}
+
+	TRY( MPI_Allreduce(MPI_IN_PLACE, result, x.columns_size*y.columns_size, MPIU_SCALAR, MPIU_SUM, x.comm) );
+}
+
+void gram(const PetscMultiVector &x, double *result){
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "gram(MultiVector,double*)");
+
+	PetscBLASInt m, p, ldx;
+	PetscScalar one = 1.0, zero = 0.0;
+	int j;
+
+	if(x.columns_size == 0){
+		return;
+	}
+
+	x.values_update();
+
+	if(x.local_length > 0){
+		TRY( PetscBLASIntCast(x.columns_size, &m) );
+		TRY( PetscBLASIntCast(x.local_length, &p) );
+		TRY( PetscBLASIntCast(x.leading_size, &ldx) );
+		BLASgemm_("T", "N", &m, &m, &p, &one, x.array, &ldx, x.array, &ldx, &zero, result, &m);
+		TRY( PetscLogFlops(2.0*x.columns_size*x.columns_size*x.local_length) );
+	} else {
+		for(j=0; j < x.columns_size*x.columns_size; j++){
+			result[j] = 0.0;
+		}
+	}
+
+	reduce_upper_petscvector(x.columns_size, result, x.comm);
+}
+
+
+} /* end of namespace */
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef PETSCVECTOR_CHECKPOINT_IMPL_H
+#define	PETSCVECTOR_CHECKPOINT_IMPL_H
+
+namespace petscvector {
+
+/* called from PetscFinalize, wait for all writers */
+PetscErrorCode checkpoint_finalize_petscvector(){
+	CHECKPOINTS_PETSCVECTOR.clear();
+	return 0;
+}
+
+/* copy values of given size to big-endian byte order (PETSc binary format) */
+void copy_big_endian_petscvector(void *dest, const void *src, size_t count, size_t size){
+#if defined(PETSC_WORDS_BIGENDIAN)
+	memcpy(dest, src, count*size);
+#else
+	const char *from = (const char*)src;
+	char *to = (char*)dest;
+	size_t i, k;
+	for(i=0;i<count;i++){
+		for(k=0;k<size;k++){
+			to[i*size + k] = from[i*size + size - 1 - k];
+		}
+	}
+#endif
+}
+
+/* constructor of empty queue, it is global object, therefore it cannot call Petsc functions */
+PetscVectorCheckpointQueue::PetscVectorCheckpointQueue(){
+	int i;
+	for(i=0;i<PETSCVECTOR_CHECKPOINTS;i++){
+		slots[i].done = true;
+		slots[i].busy = false;
+		slots[i].generation = 0;
+		slots[i].error = 0;
+		slots[i].buffer = NULL;
+		slots[i].capacity = 0;
+	}
+	next = 0;
+	generation = 0;
+	registered = false;
+}
+
+/* the writers have to be joined before the threads are destroyed */
+PetscVectorCheckpointQueue::~PetscVectorCheckpointQueue(){
+	int i;
+	for(i=0;i<PETSCVECTOR_CHECKPOINTS;i++){
+		if(slots[i].busy){
+			slots[i].writer.join();
+			slots[i].busy = false;
+		}
+		if(slots[i].buffer){
+			delete [] slots[i].buffer;
+			slots[i].buffer = NULL;
+		}
+	}
+}
+
+/* background thread, only system calls are used here (no MPI and Petsc) */
+void PetscVectorCheckpointQueue::write(PetscVectorCheckpointSlot *slot){
+	const char *data = (const char*)slot->buffer;
+	size_t bytes = slot->count*sizeof(PetscScalar);
+	size_t written = 0;
+	ssize_t length;
+	int fd;
+
+	slot->error = 0;
+
+	/* the file is not truncated here, the first process sets its size and other processes could already write */
+	fd = open(slot->filename.c_str(), O_WRONLY | O_CREAT, 0644);
+	if(fd < 0){
+		slot->error = errno;
+		slot->done = true;
+		return;
+	}
+
+	if(slot->write_header){
+		if(ftruncate(fd, slot->file_size) != 0 
+			|| pwrite(fd, slot->header, sizeof(slot->header), 0) != (ssize_t)sizeof(slot->header)){
+			slot->error = errno ? errno : EIO;
+		}
+	}
+
+	while(slot->error == 0 && written < bytes){
+		length = pwrite(fd, data + written, bytes - written, slot->offset + written);
+		if(length < 0){
+			if(errno != EINTR){
+				slot->error = errno;
+			}
+		} else {
+			written += length;
+		}
+	}
+
+	if(close(fd) != 0 && slot->error == 0){
+		slot->error = errno;
+	}
+
+	slot->done = true;
+}
+
+/* copy local values to the staging buffer and start the writer */
+long long PetscVectorCheckpointQueue::start(std::string filename, const PetscScalar *values, int count, PetscInt low, PetscInt global_size, bool write_header){
+	TRACE_PETSCVECTOR("CheckpointQueue", "FUNCTION", "start(string,double*,int,int,int,bool)");
+
+	PetscVectorCheckpointSlot *slot = &slots[next];
+	PetscInt header[2];
+	int i;
+
+	/* older writers to the same file would write the same bytes, the file has to contain the newest values */
+	for(i=0;i<PETSCVECTOR_CHECKPOINTS;i++){
+		if(slots[i].busy && slots[i].filename == filename){
+			TRACE_NOTE_PETSCVECTOR("wait for older checkpoint to the same file");
+			join(slots[i].generation);
+		}
+	}
+
+	/* bounded number of checkpoints in progress, wait for the oldest one,
+	 * its error is kept in failed and reported by wait() of its handle */
+	if(slot->busy){
+		TRACE_NOTE_PETSCVECTOR("wait for the oldest checkpoint");
+		join(slot->generation);
+	}
+
+	/* the buffer is reused, it is reallocated only if it is too small */
+	if(slot->capacity < (size_t)count){
+		if(slot->buffer){
+			delete [] slot->buffer;
+		}
+		slot->buffer = new PetscScalar[count];
+		slot->capacity = count;
+	}
+	copy_big_endian_petscvector(slot->buffer, values, count, sizeof(PetscScalar));
+
+	header[0] = VEC_FILE_CLASSID;
+	header[1] = global_size;
+	copy_big_endian_petscvector(slot->header, header, 2, sizeof(PetscInt));
+
+	slot->count = count;
+	slot->offset = 2*sizeof(PetscInt) + (long long)low*sizeof(PetscScalar);
+	slot->file_size = 2*sizeof(PetscInt) + (long long)global_size*sizeof(PetscScalar);
+	slot->write_header = write_header;
+	slot->filename = filename;
+
+	/* the writers are finished in PetscFinalize */
+	if(!registered){
+		TRY( PetscRegisterFinalize(&checkpoint_finalize_petscvector) );
+		registered = true;
+	}
+
+	generation += 1;
+	slot->generation = generation;
+	slot->error = 0;
+	slot->done = false;
+	slot->busy = true;
+	slot->writer = std::thread(&PetscVectorCheckpointQueue::write, slot);
+
+	next = (next + 1) % PETSCVECTOR_CHECKPOINTS;
+
+	return generation;
+}
+
+bool PetscVectorCheckpointQueue::ready(long long checkpoint_generation){
+	PetscVectorCheckpointSlot *slot = &slots[(checkpoint_generation - 1) % PETSCVECTOR_CHECKPOINTS];
+
+	/* the slot was already used by newer checkpoint */
+	if(slot->generation != checkpoint_generation){
+		return true;
+	}
+
+	return slot->done;
+}
+
+int PetscVectorCheckpointQueue::join(long long checkpoint_generation){
+	PetscVectorCheckpointSlot *slot = &slots[(checkpoint_generation - 1) % PETSCVECTOR_CHECKPOINTS];
+
+	std::map<long long,int>::const_iterator it;
+
+	/* the slot was already used by newer checkpoint, the result was stored when it was joined */
+	if(slot->generation != checkpoint_generation){
+		it = failed.find(checkpoint_generation);
+		return (it != failed.end()) ? it->second : 0;
+	}
+
+	if(slot->busy){
+		TRACE_PETSCVECTOR("CheckpointQueue", "FUNCTION", "join(long long)");
+		slot->writer.join();
+		slot->busy = false;
+		if(slot->error != 0){
+			failed[slot->generation] = slot->error;
+		}
+	}
+
+	return slot->error;
+}
+
+void PetscVectorCheckpointQueue::clear(){
+	TRACE_PETSCVECTOR("CheckpointQueue", "FUNCTION", "clear()");
+
+	int i;
+	for(i=0;i<PETSCVECTOR_CHECKPOINTS;i++){
+		if(slots[i].busy){
+			join(slots[i].generation);
+		}
+		if(slots[i].buffer){
+			delete [] slots[i].buffer;
+			slots[i].buffer = NULL;
+		}
+		slots[i].capacity = 0;
+	}
+	failed.clear();
+
+	/* PetscFinalize forgets registered functions, Petsc could be initialized again */
+	registered = false;
+}
+
+
+/* --------------------- PetscVectorCheckpoint ----------------------*/
+
+PetscVectorCheckpoint::PetscVectorCheckpoint(long long new_generation, MPI_Comm new_comm){
+	TRACE_PETSCVECTOR("Checkpoint", "CONSTRUCTOR", "(long long,MPI_Comm)");
+
+	generation = new_generation;
+	comm = new_comm;
+}
+
+PetscVectorCheckpoint::PetscVectorCheckpoint(PetscVectorCheckpoint &&checkpoint){
+	TRACE_PETSCVECTOR("Checkpoint", "CONSTRUCTOR", "move");
+
+	generation = checkpoint.generation;
+	comm = checkpoint.comm;
+	checkpoint.generation = 0;
+}
+
+PetscVectorCheckpoint &PetscVectorCheckpoint::operator=(PetscVectorCheckpoint &&checkpoint){
+	TRACE_PETSCVECTOR("Checkpoint", "OPERATOR", "(checkpoint = move checkpoint)");
+
+	if(this != &checkpoint){
+		generation = checkpoint.generation;
+		comm = checkpoint.comm;
+		checkpoint.generation = 0;
+	}
+
+	return *this;
+}
+
+bool PetscVectorCheckpoint::ready() const {
+	if(generation == 0){
+		return true;
+	}
+
+	return CHECKPOINTS_PETSCVECTOR.ready(generation);
+}
+
+bool PetscVectorCheckpoint::wait(){
+	TRACE_PETSCVECTOR("Checkpoint", "FUNCTION", "wait()");
+
+	int local_error = 0;
+	int global_error;
+
+	if(generation != 0){
+		local_error = CHECKPOINTS_PETSCVECTOR.join(generation);
+	}
+
+	/* the file is complete only if all processes wrote their parts */
+	TRY( MPI_Allreduce(&local_error, &global_error, 1, MPI_INT, MPI_MAX, comm) );
+
+	return global_error == 0;
+}
+
+/* snapshot local values and write them in the background */
+PetscVectorCheckpoint PetscVector::save_binary_async(std::string filename) const {
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "save_binary_async(string)");
+
+	MPI_Comm comm;
+	const PetscScalar *arr;
+	PetscInt global_size, low, high;
+	long long checkpoint_generation;
+	int rank;
+
+	valuesUpdate();
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( VecGetSize(inner_vector, &global_size) );
+	TRY( VecGetOwnershipRange(inner_vector, &low, &high) );
+
+	TRY( VecGetArrayRead(inner_vector, &arr) );
+	checkpoint_generation = CHECKPOINTS_PETSCVECTOR.start(filename, arr, high - low, low, global_size, rank == 0);
+	TRY( VecRestoreArrayRead(inner_vector, &arr) );
+
+	return PetscVectorCheckpoint(checkpoint_generation, comm);
+}
+
+
+} /* end of petscvector namespace */
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef PETSCVECTOR_ISCACHE_IMPL_H
+#define	PETSCVECTOR_ISCACHE_IMPL_H
+
+namespace petscvector {
+
+/* called from PetscFinalize, the index sets have to be destroyed while Petsc is running */
+PetscErrorCode iscache_finalize_petscvector(){
+	ISCACHE_PETSCVECTOR.clear();
+	return 0;
+}
+
+/* constructor of empty cache, it is global object, therefore it cannot call Petsc functions */
+PetscVectorISCache::PetscVectorISCache(){
+	next = 0;
+	hits = 0;
+	misses = 0;
+	registered = false;
+}
+
+/* find stride index set in the cache, if it is not there, then create it and replace the oldest item;
+ * the items are keyed by the inner communicator of Petsc, every cached index set holds a reference to it,
+ * therefore it is not freed (and its handle cannot be reused by another communicator) while the item is in the cache */
+IS PetscVectorISCache::get_stride(MPI_Comm user_comm, int begin, int end, int stride){
+	int i;
+	IS subvector_is;
+	MPI_Comm comm;
+
+	/* the same inner communicator as the index set (and the vectors) created on given communicator */
+	TRY( PetscCommDuplicate(user_comm, &comm, NULL) );
+
+	for(i=0; i < PETSCVECTOR_ISCACHESIZE; i++){
+		if(items[i].is && items[i].comm == comm && items[i].begin == begin && items[i].end == end && items[i].stride == stride){
+			TRACE_NOTE_PETSCVECTOR("index set found in cache");
+			subvector_is = items[i].is;
+			TRY( PetscObjectReference((PetscObject)subvector_is) );
+			TRY( PetscCommDestroy(&comm) );
+			hits += 1;
+			return subvector_is;
+		}
+	}
+
+	TRACE_NOTE_PETSCVECTOR("create index set");
+	TRY( ISCreateStride(comm, (end-begin)/stride+1, begin, stride, &subvector_is) );
+	misses += 1;
+
+	/* cached index sets are destroyed in PetscFinalize */
+	if(!registered){
+		TRY( PetscRegisterFinalize(&iscache_finalize_petscvector) );
+		registered = true;
+	}
+
+	/* the cache owns one reference, the caller the second one */
+	PetscVectorISCacheItem *item = &items[next];
+	if(item->is){
+		TRY( ISDestroy(&(item->is)) );
+	}
+	item->comm = comm;
+	item->begin = begin;
+	item->end = end;
+	item->stride = stride;
+	item->is = subvector_is;
+	TRY( PetscObjectReference((PetscObject)subvector_is) );
+
+	next = (next + 1) % PETSCVECTOR_ISCACHESIZE;
+
+	/* the inner communicator is referenced by the index set now */
+	TRY( PetscCommDestroy(&comm) );
+
+	return subvector_is;
+}
+
+/* destroy all cached index sets */
+void PetscVectorISCache::clear(){
+	TRACE_PETSCVECTOR("ISCache", "FUNCTION", "clear()");
+
+	int i;
+	for(i=0; i < PETSCVECTOR_ISCACHESIZE; i++){
+		if(items[i].is){
+			TRY( ISDestroy(&(items[i].is)) );
+		}
+	}
+	next = 0;
+
+	/* PetscFinalize forgets registered functions, Petsc could be initialized again */
+	registered = false;
+}
+
+int PetscVectorISCache::get_hits() const {
+	return hits;
+}
+
+int PetscVectorISCache::get_misses() const {
+	return misses;
+}
+
+
+} /* end of petscvector namespace */
+
+#endif
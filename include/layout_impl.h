@@ -0,0 +1,152 @@
+#ifndef PETSCVECTOR_LAYOUT_IMPL_H
+#define	PETSCVECTOR_LAYOUT_IMPL_H
+
+namespace petscvector {
+
+/* empty layout */
+PetscVectorLayout::PetscVectorLayout(){
+	comm = MPI_COMM_NULL;
+	global_size = 0;
+	nproc = 0;
+	rank = 0;
+	ranges = NULL;
+}
+
+/* split the vector in the same way as VecSetSizes and gather the ownership ranges */
+PetscVectorLayout::PetscVectorLayout(int n, int local_size, MPI_Comm new_comm){
+	TRACE_PETSCVECTOR("VectorLayout", "CONSTRUCTOR", "(int,int,MPI_Comm)");
+
+	PetscInt local_n = local_size;
+	PetscInt global_n = n;
+	int r;
+
+	comm = new_comm;
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( PetscSplitOwnership(comm, &local_n, &global_n) );
+
+	/* every process knows the local sizes of all processes, the ranges are their prefix sums */
+	ranges = new int[nproc+1];
+	ranges[0] = 0;
+	local_size = local_n;
+	TRY( MPI_Allgather(&local_size, 1, MPI_INT, ranges+1, 1, MPI_INT, comm) );
+	for(r=0; r < nproc; r++){
+		ranges[r+1] += ranges[r];
+	}
+	global_size = ranges[nproc];
+
+	if(global_size != global_n){
+		PetscError(comm, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Sum of local sizes does not match the global size");
+	}
+}
+
+/* layout of existing vector, ranges are stored in the vector, no communication */
+PetscVectorLayout::PetscVectorLayout(Vec vec){
+	TRACE_PETSCVECTOR("VectorLayout", "CONSTRUCTOR", "(Vec)");
+
+	const PetscInt *vec_ranges;
+	int r;
+
+	TRY( PetscObjectGetComm((PetscObject)vec, &comm) );
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( VecGetOwnershipRanges(vec, &vec_ranges) );
+
+	ranges = new int[nproc+1];
+	for(r=0; r <= nproc; r++){
+		ranges[r] = vec_ranges[r];
+	}
+	global_size = ranges[nproc];
+}
+
+PetscVectorLayout::PetscVectorLayout(const PetscVectorLayout &layout){
+	comm = layout.comm;
+	global_size = layout.global_size;
+	nproc = layout.nproc;
+	rank = layout.rank;
+	ranges = NULL;
+	if(layout.ranges){
+		ranges = new int[nproc+1];
+		std::memcpy(ranges, layout.ranges, (nproc+1)*sizeof(int));
+	}
+}
+
+PetscVectorLayout &PetscVectorLayout::operator=(const PetscVectorLayout &layout){
+	if(this != &layout){
+		PetscVectorLayout copy(layout);
+		std::swap(comm, copy.comm);
+		std::swap(global_size, copy.global_size);
+		std::swap(nproc, copy.nproc);
+		std::swap(rank, copy.rank);
+		std::swap(ranges, copy.ranges);
+	}
+	return *this;
+}
+
+PetscVectorLayout::~PetscVectorLayout(){
+	if(ranges){
+		delete [] ranges;
+	}
+}
+
+MPI_Comm PetscVectorLayout::get_comm() const {
+	return comm;
+}
+
+int PetscVectorLayout::size() const {
+	return global_size;
+}
+
+int PetscVectorLayout::local_size() const {
+	if(!ranges){
+		return 0;
+	}
+	return ranges[rank+1] - ranges[rank];
+}
+
+void PetscVectorLayout::get_ownership(int *low, int *high) const {
+	if(!ranges){
+		if(low) *low = 0;
+		if(high) *high = 0;
+		return;
+	}
+	if(low) *low = ranges[rank];
+	if(high) *high = ranges[rank+1];
+}
+
+const int *PetscVectorLayout::get_ranges() const {
+	return ranges;
+}
+
+/* same distribution of components on congruent communicators */
+bool PetscVectorLayout::operator==(const PetscVectorLayout &layout) const {
+	int result, r;
+
+	if(!ranges || !layout.ranges){
+		return !ranges && !layout.ranges;
+	}
+	if(global_size != layout.global_size || nproc != layout.nproc){
+		return false;
+	}
+	if(comm != layout.comm){
+		TRY( MPI_Comm_compare(comm, layout.comm, &result) );
+		if(result != MPI_IDENT && result != MPI_CONGRUENT){
+			return false;
+		}
+	}
+	for(r=0; r <= nproc; r++){
+		if(ranges[r] != layout.ranges[r]){
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PetscVectorLayout::operator!=(const PetscVectorLayout &layout) const {
+	return !(*this == layout);
+}
+
+
+} /* end of namespace */
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef PETSCVECTOR_MULTIVECTOR_IMPL_H
+#define	PETSCVECTOR_MULTIVECTOR_IMPL_H
+
+namespace petscvector {
+
+PetscMultiVector::PetscMultiVector(const PetscVectorLayout &layout, int k){
+	TRACE_PETSCVECTOR("MultiVector", "CONSTRUCTOR", "(layout,int)");
+
+	allocate(layout, k);
+}
+
+PetscMultiVector::PetscMultiVector(const PetscVector &vec, int k){
+	TRACE_PETSCVECTOR("MultiVector", "CONSTRUCTOR", "(PetscVector,int)");
+
+	allocate(vec.get_layout(), k);
+}
+
+/* destroy columns before the array they are using */
+PetscMultiVector::~PetscMultiVector(){
+	TRACE_PETSCVECTOR("MultiVector", "DESTRUCTOR", "");
+
+	if(columns){
+		delete [] columns;
+	}
+	if(array_allocated){
+		PetscFree(array_allocated);
+	}
+}
+
+/* one array for all columns, every column starts at the beginning of cache line
+ * (PetscMalloc aligns less, the memory is larger by one padding and the array is shifted) */
+void PetscMultiVector::allocate(const PetscVectorLayout &layout, int k){
+	size_t alignment = PETSCVECTOR_MULTIPAD*sizeof(PetscScalar);
+	int j;
+
+	columns_size = k;
+	local_length = layout.local_size();
+	leading_size = ((local_length + PETSCVECTOR_MULTIPAD - 1)/PETSCVECTOR_MULTIPAD)*PETSCVECTOR_MULTIPAD;
+	comm = layout.get_comm();
+	array = NULL;
+	array_allocated = NULL;
+	columns = NULL;
+
+	if(columns_size <= 0){
+		columns_size = 0;
+		return;
+	}
+
+	TRY( PetscMalloc1((size_t)leading_size*columns_size + PETSCVECTOR_MULTIPAD, &array_allocated) );
+	array = (PetscScalar*)((((size_t)array_allocated + alignment - 1)/alignment)*alignment);
+#ifdef PETSCVECTOR_OPENMP
+	/* every thread touches the same rows of all columns as in the kernels */
+	int i, t, block_end;
+	#pragma omp parallel for schedule(static) private(j, t, block_end) if(local_length >= PETSCVECTOR_OPENMP_MINSIZE)
+	for(i=0; i < leading_size; i += PETSCVECTOR_BLOCKSIZE){
+		block_end = i + PETSCVECTOR_BLOCKSIZE;
+		if(block_end > leading_size) block_end = leading_size;
+		for(j=0; j < columns_size; j++){
+			for(t=i; t < block_end; t++){
+				array[(size_t)j*leading_size + t] = 0.0;
+			}
+		}
+	}
+#else
+	TRY( PetscMemzero(array, (size_t)leading_size*columns_size*sizeof(PetscScalar)) );
+#endif
+
+	columns = new PetscVector[columns_size];
+	for(j=0; j < columns_size; j++){
+		TRY( VecCreateMPIWithArray(comm, 1, local_length, layout.size(), array + (size_t)j*leading_size, &(columns[j].inner_vector)) );
+		columns[j].view = true;
+		columns[j].layout_size = layout.size();
+		columns[j].layout_local_size = local_length;
+		layout.get_ownership(&(columns[j].layout_low), &(columns[j].layout_high));
+	}
+}
+
+/* values set by set(int,double) in columns have to be in the array */
+void PetscMultiVector::values_update() const{
+	int j;
+	for(j=0; j < columns_size; j++){
+		columns[j].valuesUpdate();
+	}
+}
+
+int PetscMultiVector::get_columns() const{
+	return columns_size;
+}
+
+int PetscMultiVector::size() const{
+	return (columns_size > 0) ? columns[0].size() : 0;
+}
+
+int PetscMultiVector::local_size() const{
+	return local_length;
+}
+
+PetscVector &PetscMultiVector::operator()(int j){
+	return columns[j];
+}
+
+const PetscVector &PetscMultiVector::operator()(int j) const{
+	return columns[j];
+}
+
+void PetscMultiVector::set(double value){
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "set(double)");
+
+	int j;
+	for(j=0; j < columns_size; j++){
+		columns[j].set(value);
+	}
+}
+
+/* the block of y stays in cache while it is multiplied by all columns */
+void PetscMultiVector::mdot(const PetscVector &y, double *result) const{
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "mdot(PetscVector,double*)");
+
+	const PetscScalar *arr_y;
+	const PetscScalar *x;
+	double value;
+	int i, j, begin, end;
+
+	if(columns_size == 0){
+		return;
+	}
+	if(y.local_size() != local_length){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+		return;
+	}
+
+	values_update();
+	y.valuesUpdate();
+
+	for(j=0; j < columns_size; j++){
+		result[j] = 0.0;
+	}
+
+	TRY( VecGetArrayRead(y.inner_vector, &arr_y) );
+	for(begin=0; begin < local_length; begin += PETSCVECTOR_BLOCKSIZE){
+		end = begin + PETSCVECTOR_BLOCKSIZE;
+		if(end > local_length) end = local_length;
+
+		for(j=0; j < columns_size; j++){
+			x = array + (size_t)j*leading_size;
+			value = 0.0;
+			for(i=begin; i < end; i++){
+				value += x[i]*arr_y[i];
+			}
+			result[j] += value;
+		}
+	}
+	TRY( VecRestoreArrayRead(y.inner_vector, &arr_y) );
+	TRY( PetscLogFlops(2.0*columns_size*local_length) );
+
+	TRY( MPI_Allreduce(MPI_IN_PLACE, result, columns_size, MPIU_SCALAR, MPIU_SUM, comm) );
+}
+
+/* the columns are stored one after another, they are read in the order of memory */
+void PetscMultiVector::norms(double *result) const{
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "norms(double*)");
+
+	const PetscScalar *x;
+	double value;
+	int i, j;
+
+	if(columns_size == 0){
+		return;
+	}
+
+	values_update();
+
+	for(j=0; j < columns_size; j++){
+		x = array + (size_t)j*leading_size;
+		value = 0.0;
+		for(i=0; i < local_length; i++){
+			value += x[i]*x[i];
+		}
+		result[j] = value;
+	}
+	TRY( PetscLogFlops(2.0*columns_size*local_length) );
+
+	TRY( MPI_Allreduce(MPI_IN_PLACE, result, columns_size, MPIU_SCALAR, MPIU_SUM, comm) );
+	for(j=0; j < columns_size; j++){
+		result[j] = std::sqrt(result[j]);
+	}
+}
+
+/* the block of y stays in cache while the multiples of all columns are added */
+void PetscMultiVector::maxpy(PetscVector &y, const double *alpha) const{
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "maxpy(PetscVector,double*)");
+
+	PetscScalar *arr_y;
+	const PetscScalar *x;
+	double a;
+	int i, j, begin, end;
+
+	if(y.local_size() != local_length){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+		return;
+	}
+
+	values_update();
+
+	y.get_array(&arr_y);
+#ifdef PETSCVECTOR_OPENMP
+	#pragma omp parallel for schedule(static) private(i, j, end, a, x) if(local_length >= PETSCVECTOR_OPENMP_MINSIZE)
+#endif
+	for(begin=0; begin < local_length; begin += PETSCVECTOR_BLOCKSIZE){
+		end = begin + PETSCVECTOR_BLOCKSIZE;
+		if(end > local_length) end = local_length;
+
+		for(j=0; j < columns_size; j++){
+			a = alpha[j];
+			if(a == 0.0){
+				continue;
+			}
+			x = array + (size_t)j*leading_size;
+			for(i=begin; i < end; i++){
+				arr_y[i] += a*x[i];
+			}
+		}
+	}
+	y.restore_array(&arr_y);
+	TRY( PetscLogFlops(2.0*columns_size*local_length) );
+}
+
+/* the columns are changed through VecGetArray to notify Petsc about the change of values */
+void PetscMultiVector::axpy(const double *alpha, const PetscVector &y){
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "axpy(double*,PetscVector)");
+
+	const PetscScalar *arr_y;
+	PetscScalar *x;
+	double a;
+	int i, j, begin, end;
+
+	if(y.local_size() != local_length){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+		return;
+	}
+
+	values_update();
+	y.valuesUpdate();
+
+	for(j=0; j < columns_size; j++){
+		TRY( VecGetArray(columns[j].inner_vector, &x) );
+	}
+	TRY( VecGetArrayRead(y.inner_vector, &arr_y) );
+#ifdef PETSCVECTOR_OPENMP
+	#pragma omp parallel for schedule(static) private(i, j, end, a, x) if(local_length >= PETSCVECTOR_OPENMP_MINSIZE)
+#endif
+	for(begin=0; begin < local_length; begin += PETSCVECTOR_BLOCKSIZE){
+		end = begin + PETSCVECTOR_BLOCKSIZE;
+		if(end > local_length) end = local_length;
+
+		for(j=0; j < columns_size; j++){
+			a = alpha[j];
+			x = array + (size_t)j*leading_size;
+			for(i=begin; i < end; i++){
+				x[i] += a*arr_y[i];
+			}
+		}
+	}
+	TRY( VecRestoreArrayRead(y.inner_vector, &arr_y) );
+	for(j=0; j < columns_size; j++){
+		x = array + (size_t)j*leading_size;
+		TRY( VecRestoreArray(columns[j].inner_vector, &x) );
+	}
+	TRY( PetscLogFlops(2.0*columns_size*local_length) );
+}
+
+
+} /* end of namespace */
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef PETSCVECTOR_ORTHOGONAL_IMPL_H
+#define	PETSCVECTOR_ORTHOGONAL_IMPL_H
+
+namespace petscvector {
+
+/* v_j = v_j - sum{h_ij*q_i}, the blocks of all arrays stay in cache while all products are subtracted */
+void project_local_petscvector(int k, const PetscScalar * const *q, int l, PetscScalar * const *v, int n, const double *h){
+	const PetscScalar *qi;
+	PetscScalar *vj;
+	double a;
+	int i, j, t, begin, end;
+
+	for(begin=0; begin < n; begin += PETSCVECTOR_BLOCKSIZE){
+		end = begin + PETSCVECTOR_BLOCKSIZE;
+		if(end > n) end = n;
+
+		for(j=0; j < l; j++){
+			vj = v[j];
+			for(i=0; i < k; i++){
+				a = h[i+j*k];
+				qi = q[i];
+				for(t=begin; t < end; t++){
+					vj[t] -= a*qi[t];
+				}
+			}
+		}
+	}
+}
+
+/* QR factorization of tall-skinny matrix distributed by rows, the local part a (n x l, leading dimension lda)
+ * is replaced by the local part of Q, the triangular factor r (l x l) is the same on all processes */
+void tsqr_local_petscvector(int n, int l, PetscScalar *a, int lda, double *r, MPI_Comm comm){
+	PetscScalar *tau, *work, *local_r, *gathered, *stacked, *product;
+	PetscScalar work_size, one = 1.0, zero = 0.0;
+	PetscBLASInt bn, bl, bkk, blda, bm, lwork, query, info;
+	int nproc, rank, kk, kk_p, m, offset, i, j, p;
+
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+
+	/* the local factor has only kk nonzero rows, its last item is kk (sent together with the factor) */
+	kk = (n < l) ? n : l;
+	TRY( PetscMalloc1(l, &tau) );
+	TRY( PetscCalloc1((size_t)l*l + 1, &local_r) );
+	TRY( PetscMalloc1((size_t)nproc*(l*l + 1), &gathered) );
+	TRY( PetscMalloc1((size_t)nproc*l*l, &stacked) );
+	local_r[l*l] = kk;
+
+	/* stacked matrix has the nonzero rows of all factors, at least l rows */
+	m = nproc*l;
+	TRY( PetscBLASIntCast(n, &bn) );
+	TRY( PetscBLASIntCast(l, &bl) );
+	TRY( PetscBLASIntCast(kk, &bkk) );
+	TRY( PetscBLASIntCast(lda, &blda) );
+	TRY( PetscBLASIntCast(m, &bm) );
+
+	/* the largest workspace of all factorizations */
+	query = -1;
+	LAPACKgeqrf_(&bm, &bl, stacked, &bm, tau, &work_size, &query, &info);
+	lwork = (PetscBLASInt)work_size;
+	if(kk > 0){
+		LAPACKgeqrf_(&bn, &bl, a, &blda, tau, &work_size, &query, &info);
+		if((PetscBLASInt)work_size > lwork) lwork = (PetscBLASInt)work_size;
+	}
+	if(lwork < l) lwork = l;
+	TRY( PetscMalloc1(lwork, &work) );
+
+	/* local factorization a = Q_1*R_1, the rows of R_1 below kk are zeros */
+	if(kk > 0){
+		LAPACKgeqrf_(&bn, &bl, a, &blda, tau, work, &lwork, &info);
+		if(info) PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_LIB, PETSC_ERROR_INITIAL, "LAPACK geqrf failed");
+		for(j=0; j < l; j++){
+			for(i=0; i <= j && i < kk; i++){
+				local_r[i+j*l] = a[i+(size_t)j*lda];
+			}
+		}
+		LAPACKorgqr_(&bn, &bkk, &bkk, a, &blda, tau, work, &lwork, &info);
+		if(info) PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_LIB, PETSC_ERROR_INITIAL, "LAPACK orgqr failed");
+	}
+
+	/* the triangular factors of all processes are stacked and factorized again (the same on every process),
+	 * zero rows are not stacked, otherwise the columns of Q for rank deficient matrix would not be orthonormal */
+	TRY( MPI_Allgather(local_r, l*l + 1, MPIU_SCALAR, gathered, l*l + 1, MPIU_SCALAR, comm) );
+	m = 0;
+	offset = 0;
+	for(p=0; p < nproc; p++){
+		if(p == rank) offset = m;
+		m += (int)gathered[(size_t)p*(l*l + 1) + l*l];
+	}
+	if(m < l) m = l;
+	TRY( PetscBLASIntCast(m, &bm) );
+	TRY( PetscMemzero(stacked, (size_t)m*l*sizeof(PetscScalar)) );
+	i = 0;
+	for(p=0; p < nproc; p++){
+		kk_p = (int)gathered[(size_t)p*(l*l + 1) + l*l];
+		for(j=0; j < l; j++){
+			TRY( PetscMemcpy(stacked + i + (size_t)j*m, gathered + (size_t)p*(l*l + 1) + j*l, kk_p*sizeof(PetscScalar)) );
+		}
+		i += kk_p;
+	}
+
+	LAPACKgeqrf_(&bm, &bl, stacked, &bm, tau, work, &lwork, &info);
+	if(info) PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_LIB, PETSC_ERROR_INITIAL, "LAPACK geqrf failed");
+	for(j=0; j < l; j++){
+		for(i=0; i < l; i++){
+			local_r[i+j*l] = (i <= j) ? stacked[i+(size_t)j*m] : 0.0;
+		}
+	}
+	LAPACKorgqr_(&bm, &bl, &bl, stacked, &bm, tau, work, &lwork, &info);
+	if(info) PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_LIB, PETSC_ERROR_INITIAL, "LAPACK orgqr failed");
+
+	/* Q = Q_1*Q_2, only the rows of Q_2 which belong to this process */
+	if(kk > 0){
+		TRY( PetscMalloc1((size_t)n*l, &product) );
+		BLASgemm_("N", "N", &bn, &bl, &bkk, &one, a, &blda, stacked + offset, &bm, &zero, product, &bn);
+		for(j=0; j < l; j++){
+			TRY( PetscMemcpy(a + (size_t)j*lda, product + (size_t)j*n, n*sizeof(PetscScalar)) );
+		}
+		TRY( PetscFree(product) );
+	}
+
+	/* the diagonal of R is not negative, then the factorization does not depend on the number of processes */
+	for(j=0; j < l; j++){
+		if(local_r[j+j*l] < 0.0){
+			for(i=j; i < l; i++){
+				local_r[j+i*l] = -local_r[j+i*l];
+			}
+			for(i=0; i < n; i++){
+				a[i+(size_t)j*lda] = -a[i+(size_t)j*lda];
+			}
+		}
+	}
+
+	if(r){
+		TRY( PetscMemcpy(r, local_r, (size_t)l*l*sizeof(PetscScalar)) );
+	}
+	TRY( PetscLogFlops(4.0*n*l*l + 4.0*m*l*l) );
+
+	TRY( PetscFree(work) );
+	TRY( PetscFree(stacked) );
+	TRY( PetscFree(gathered) );
+	TRY( PetscFree(local_r) );
+	TRY( PetscFree(tau) );
+}
+
+/* two passes of block classical Gram-Schmidt, each of them with one reduction */
+void cgs2(int k, const PetscVector * const *q, int l, PetscVector * const *v, double *r){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "cgs2(int,PetscVector**,int,PetscVector**,double*)");
+
+	const PetscScalar **arrays_q;
+	PetscScalar **arrays_v;
+	double *h;
+	int local_size, pass, i, j;
+
+	if(k <= 0 || l <= 0){
+		return;
+	}
+
+	/* the projection writes local_size values to every v_j */
+	local_size = q[0]->local_size();
+	for(j=0; j < k+l; j++){
+		if(((j < k) ? q[j] : v[j-k])->local_size() != local_size){
+			PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+			return;
+		}
+	}
+
+	TRY( PetscMalloc1((size_t)k*l, &h) );
+	TRY( PetscMalloc1(k, &arrays_q) );
+	TRY( PetscMalloc1(l, &arrays_v) );
+	if(r){
+		for(j=0; j < k*l; j++){
+			r[j] = 0.0;
+		}
+	}
+
+	for(pass=0; pass < 2; pass++){
+		block_dot(k, q, l, v, h);
+
+		for(i=0; i < k; i++){
+			TRY( VecGetArrayRead(q[i]->inner_vector, &(arrays_q[i])) );
+		}
+		for(j=0; j < l; j++){
+			v[j]->get_array(&(arrays_v[j]));
+		}
+
+		project_local_petscvector(k, arrays_q, l, arrays_v, local_size, h);
+
+		for(j=0; j < l; j++){
+			v[j]->restore_array(&(arrays_v[j]));
+		}
+		for(i=0; i < k; i++){
+			TRY( VecRestoreArrayRead(q[i]->inner_vector, &(arrays_q[i])) );
+		}
+		TRY( PetscLogFlops(2.0*k*l*local_size) );
+
+		if(r){
+			for(j=0; j < k*l; j++){
+				r[j] += h[j];
+			}
+		}
+	}
+
+	TRY( PetscFree(arrays_v) );
+	TRY( PetscFree(arrays_q) );
+	TRY( PetscFree(h) );
+}
+
+/* the local parts are copied to one column-major array for LAPACK */
+void tsqr(int l, PetscVector * const *v, double *r){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "tsqr(int,PetscVector**,double*)");
+
+	PetscScalar **arrays;
+	PetscScalar *a;
+	MPI_Comm comm;
+	int local_size, j;
+
+	if(l <= 0){
+		return;
+	}
+
+	local_size = v[0]->local_size();
+	for(j=0; j < l; j++){
+		if(v[j]->local_size() != local_size){
+			PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+			return;
+		}
+	}
+
+	TRY( PetscMalloc1(l, &arrays) );
+	TRY( PetscMalloc1((size_t)local_size*l + 1, &a) );
+	for(j=0; j < l; j++){
+		v[j]->get_array(&(arrays[j]));
+		TRY( PetscMemcpy(a + (size_t)j*local_size, arrays[j], local_size*sizeof(PetscScalar)) );
+	}
+
+	TRY( PetscObjectGetComm((PetscObject)(v[0]->inner_vector), &comm) );
+	tsqr_local_petscvector(local_size, l, a, (local_size > 0) ? local_size : 1, r, comm);
+
+	for(j=0; j < l; j++){
+		TRY( PetscMemcpy(arrays[j], a + (size_t)j*local_size, local_size*sizeof(PetscScalar)) );
+		v[j]->restore_array(&(arrays[j]));
+	}
+	TRY( PetscFree(a) );
+	TRY( PetscFree(arrays) );
+}
+
+/* v = v - q*(q^T*v) twice, the local products and updates are matrix products on the arrays */
+void cgs2(const PetscMultiVector &q, PetscMultiVector &v, double *r){
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "cgs2(MultiVector,MultiVector,double*)");
+
+	PetscBLASInt bn, bk, bl, ldq, ldv;
+	PetscScalar one = 1.0, minus_one = -1.0;
+	PetscScalar *x;
+	double *h;
+	int k, l, pass, j;
+
+	k = q.columns_size;
+	l = v.columns_size;
+	if(k == 0 || l == 0){
+		return;
+	}
+	if(q.local_length != v.local_length){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+		return;
+	}
+
+	TRY( PetscMalloc1((size_t)k*l, &h) );
+	if(r){
+		for(j=0; j < k*l; j++){
+			r[j] = 0.0;
+		}
+	}
+
+	for(pass=0; pass < 2; pass++){
+		block_dot(q, v, h);
+
+		if(v.local_length > 0){
+			TRY( PetscBLASIntCast(v.local_length, &bn) );
+			TRY( PetscBLASIntCast(k, &bk) );
+			TRY( PetscBLASIntCast(l, &bl) );
+			TRY( PetscBLASIntCast(q.leading_size, &ldq) );
+			TRY( PetscBLASIntCast(v.leading_size, &ldv) );
+
+			/* the columns are changed through VecGetArray to notify Petsc about the change of values */
+			for(j=0; j < l; j++){
+				v.columns[j].get_array(&x);
+			}
+			BLASgemm_("N", "N", &bn, &bl, &bk, &minus_one, q.array, &ldq, h, &bk, &one, v.array, &ldv);
+			for(j=0; j < l; j++){
+				x = v.array + (size_t)j*v.leading_size;
+				v.columns[j].restore_array(&x);
+			}
+			TRY( PetscLogFlops(2.0*k*l*v.local_length) );
+		}
+
+		if(r){
+			for(j=0; j < k*l; j++){
+				r[j] += h[j];
+			}
+		}
+	}
+
+	TRY( PetscFree(h) );
+}
+
+/* the array of multivector is already column-major, it is factorized in place */
+void tsqr(PetscMultiVector &v, double *r){
+	TRACE_PETSCVECTOR("MultiVector", "FUNCTION", "tsqr(MultiVector,double*)");
+
+	PetscScalar *x;
+	int j;
+
+	if(v.columns_size == 0){
+		return;
+	}
+
+	v.values_update();
+
+	for(j=0; j < v.columns_size; j++){
+		v.columns[j].get_array(&x);
+	}
+	tsqr_local_petscvector(v.local_length, v.columns_size, v.array, (v.leading_size > 0) ? v.leading_size : 1, r, v.comm);
+	for(j=0; j < v.columns_size; j++){
+		x = v.array + (size_t)j*v.leading_size;
+		v.columns[j].restore_array(&x);
+	}
+}
+
+
+} /* end of namespace */
+
+#endif
@@ -15,9 +15,7 @@
 
 /* include petsc */
 #include "petsc.h"
-
-/* std:list for linear combinations */
-#include <list>
+#include "petscblaslapack.h"
 
 /* basic input/output in c++ */
 #include <iostream>
@@ -25,6 +23,41 @@
 /* for manipulating with strings */
 #include <string>
 
+/* std::move for temporary linear combinations */
+#include <utility>
+
+/* elementwise functions in combinations */
+#include <cmath>
+
+/* formatting of values in text files */
+#include <cstdio>
+
+/* background writer of asynchronous checkpoints */
+#include <thread>
+#include <atomic>
+#include <cerrno>
+#include <map>
+
+/* memory mapped files in load_local_mapped */
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* optional threads in local kernels (compile with OpenMP and -DPETSCVECTOR_OPENMP),
+ * the trace records could not be written from threads, therefore traced code uses one thread */
+#if defined(PETSCVECTOR_OPENMP) && defined(PETSCVECTOR_TRACE)
+ #undef PETSCVECTOR_OPENMP
+#endif
+#ifdef PETSCVECTOR_OPENMP
+ #ifndef _OPENMP
+  #error "PETSCVECTOR_OPENMP requires compilation with OpenMP"
+ #endif
+ #include <omp.h>
+#endif
+
+
 /* to deal with errors, call Petsc functions with TRY(fun); */
 static PetscErrorCode ierr; /**< to deal with PetscError */
 
@@ -34,11 +67,136 @@ static PetscErrorCode ierr; /**< to deal with PetscError */
 */
 #define TRY( f) {ierr = f; do {if (PetscUnlikely(ierr)) {PetscError(PETSC_COMM_SELF,__LINE__,PETSC_FUNCTION_NAME,__FILE__,ierr,PETSC_ERROR_IN_CXX,0);}} while(0);}
 
+/**
+ * \def TRACE_PETSCVECTOR(owner,kind,name)
+ * Macro for tracing the calls of functions, i.e. TRACE_PETSCVECTOR("PetscVector","FUNCTION","set(double)").
+ * The tracing is compiled only if PETSCVECTOR_TRACE is defined, otherwise the macro is empty and costs nothing.
+ * If compiled, the record is written if DEBUG_MODE_PETSCVECTOR >= 100.
+*/
+
+/**
+ * \def TRACE_NOTE_PETSCVECTOR(note)
+ * Macro for tracing the steps inside the traced function, written if DEBUG_MODE_PETSCVECTOR >= 100.
+*/
+
+/**
+ * \def TRACE_VALUE_PETSCVECTOR(name,value)
+ * Macro for tracing the values computed inside the traced function, written if DEBUG_MODE_PETSCVECTOR >= 99.
+*/
+#ifdef PETSCVECTOR_TRACE
+ #define TRACE_PETSCVECTOR( owner, kind, name) petscvector::trace_record(100, owner, kind, name, 0.0, __FILE__, __LINE__)
+ #define TRACE_NOTE_PETSCVECTOR( note) petscvector::trace_record(100, "", "NOTE", note, 0.0, __FILE__, __LINE__)
+ #define TRACE_VALUE_PETSCVECTOR( name, value) petscvector::trace_record(99, "", "VALUE", name, value, __FILE__, __LINE__)
+#else
+ #define TRACE_PETSCVECTOR( owner, kind, name) do {} while(0)
+ #define TRACE_NOTE_PETSCVECTOR( note) do {} while(0)
+ #define TRACE_VALUE_PETSCVECTOR( name, value) do {} while(0)
+#endif
+
+/**
+ * \def PETSCVECTOR_BLOCKSIZE
+ * Number of components processed at once by the fused kernels, the block of the result should stay in cache.
+*/
+#ifndef PETSCVECTOR_BLOCKSIZE
+ #define PETSCVECTOR_BLOCKSIZE 512
+#endif
+
+/**
+ * \def PETSCVECTOR_COMBSIZE
+ * Number of nodes of linear combination stored without allocation.
+*/
+#ifndef PETSCVECTOR_COMBSIZE
+ #define PETSCVECTOR_COMBSIZE 8
+#endif
+
+/**
+ * \def PETSCVECTOR_ISCACHESIZE
+ * Number of index sets of subvectors in the global cache ISCACHE_PETSCVECTOR (shared by all vectors).
+*/
+#ifndef PETSCVECTOR_ISCACHESIZE
+ #define PETSCVECTOR_ISCACHESIZE 16
+#endif
+
+/**
+ * \def PETSCVECTOR_REDUCTIONSIZE
+ * Number of reductions stored in the batch without allocation.
+*/
+#ifndef PETSCVECTOR_REDUCTIONSIZE
+ #define PETSCVECTOR_REDUCTIONSIZE 8
+#endif
+
+/**
+ * \def PETSCVECTOR_POOLSIZE
+ * Maximal number of inner vectors kept in the pool for reuse.
+*/
+#ifndef PETSCVECTOR_POOLSIZE
+ #define PETSCVECTOR_POOLSIZE 16
+#endif
+
+/**
+ * \def PETSCVECTOR_PRINTCHUNK
+ * Number of components sent to the first process at once or formatted at once during printing and writing text files.
+*/
+#ifndef PETSCVECTOR_PRINTCHUNK
+ #define PETSCVECTOR_PRINTCHUNK 1024
+#endif
+
+/**
+ * \def PETSCVECTOR_CHECKPOINTS
+ * Maximal number of asynchronous checkpoints in progress, the next one waits for the oldest one.
+*/
+#ifndef PETSCVECTOR_CHECKPOINTS
+ #define PETSCVECTOR_CHECKPOINTS 2
+#endif
+
+/**
+ * \def PETSCVECTOR_MULTIPAD
+ * Local parts of columns of multivector are padded to the multiple of this number of scalars (8 doubles are one cache line).
+*/
+#ifndef PETSCVECTOR_MULTIPAD
+ #define PETSCVECTOR_MULTIPAD 8
+#endif
+
+/**
+ * \def PETSCVECTOR_OPENMP_MINSIZE
+ * Local parts shorter than this number of components are processed by one thread (only if PETSCVECTOR_OPENMP is defined).
+*/
+#ifndef PETSCVECTOR_OPENMP_MINSIZE
+ #define PETSCVECTOR_OPENMP_MINSIZE 32768
+#endif
+
 /* we are using namespace petscvector */
 namespace petscvector {
 
-int DEBUG_MODE_PETSCVECTOR = true; /**< defines the debug mode of the functions */
+int DEBUG_MODE_PETSCVECTOR = true; /**< defines the debug mode of the functions, used only if compiled with PETSCVECTOR_TRACE */
 bool PETSC_INITIALIZED = false; /**< to deal with PetscInitialize and PetscFinalize outside this class */
+bool FUSED_MODE_PETSCVECTOR = true; /**< evaluate linear combinations in one sweep through local arrays, otherwise use VecScale+VecShift+VecMAXPY */
+bool COPY_ON_WRITE_PETSCVECTOR = false; /**< copies of vectors share the inner vector, the values are copied before the first change */
+bool POOL_MODE_PETSCVECTOR = true; /**< inner vectors of destroyed vectors are kept in the pool and reused instead of new VecDuplicate */
+
+#ifdef PETSCVECTOR_TRACE
+int TRACE_FORMAT_PETSCVECTOR = 0; /**< format of trace records, 0 = messages, 1 = one structured record per line */
+std::ostream *TRACE_STREAM_PETSCVECTOR = &std::cout; /**< the stream where the trace records are written */
+
+/** @brief Write trace record.
+*
+*  Called from TRACE_PETSCVECTOR macros, the record is written only if DEBUG_MODE_PETSCVECTOR >= level.
+*  Structured record (TRACE_FORMAT_PETSCVECTOR = 1) contains the sequence number, MPI rank, wall time,
+*  class, kind of the call, name, value and the place in the source code.
+*
+*  @param level minimal debug mode to write the record
+*  @param owner name of the class
+*  @param kind CONSTRUCTOR, DESTRUCTOR, FUNCTION, OPERATOR, NOTE or VALUE
+*  @param name name of the call, note or value
+*  @param value traced value (used with VALUE)
+*  @param file source file
+*  @param line line in source file
+*/
+void trace_record(int level, const char *owner, const char *kind, const char *name, double value, const char *file, int line);
+#endif
+
+MPI_Datatype REDUCTION_TYPE_PETSCVECTOR = MPI_DATATYPE_NULL; /**< pair (value, type of reduction) used in batched reductions, created with first batch */
+MPI_Op REDUCTION_OP_PETSCVECTOR = MPI_OP_NULL; /**< operation on pairs, sum or max according to the type of reduction */
 
 /* define "all" stuff */
 class petscvector_all_type {} all; /**< brings an opportunity to call PetscVector(all) */
@@ -55,6 +213,259 @@ class PetscVectorWrapperSub;
 /* wrapper to allow (vector or subvector) = mul(v1,v2) */
 class PetscVectorWrapperMul; 
 
+/* wrapper to allow (vector or subvector) = v1/v2 */
+class PetscVectorWrapperDiv; 
+
+/* batch of reductions computed together */
+class PetscVectorReduction;
+
+/* result of reduction which is still computed */
+class PetscVectorFuture;
+
+/* checkpoint which is still written */
+class PetscVectorCheckpoint;
+
+/* block of vectors with the same layout stored in one array */
+class PetscMultiVector;
+
+
+/** \struct PetscVectorISCacheItem
+ *  \brief Cached stride index set of the subvector.
+ *
+*/
+struct PetscVectorISCacheItem {
+	MPI_Comm comm; /**< inner Petsc communicator of the index set, kept alive by the index set */
+	int begin; /**< first index */
+	int end; /**< last index */
+	int stride; /**< step between indices */
+	IS is; /**< cached index set, NULL if the item is empty */
+
+	PetscVectorISCacheItem() : comm(MPI_COMM_NULL), begin(0), end(-1), stride(1), is(NULL) {}
+};
+
+/** \class PetscVectorISCache
+ *  \brief Cache of stride index sets of subvectors.
+ *
+ *  The stride index set depends only on the communicator, the first index, the last index and the step,
+ *  therefore it is shared by all vectors on the same communicator (temporaries and vectors from the pool as well).
+ *  The cache holds one reference of every index set, the oldest one is replaced when the cache is full.
+ *  The items are keyed by the inner Petsc communicator (PetscCommDuplicate), which is referenced by the cached index set,
+ *  therefore the handle of freed communicator never matches a cached item.
+ *  Cache is emptied in PetscFinalize, global instance is ISCACHE_PETSCVECTOR.
+*/
+class PetscVectorISCache {
+	private:
+		PetscVectorISCacheItem items[PETSCVECTOR_ISCACHESIZE]; /**< cached index sets */
+		int next; /**< item to be replaced when the cache is full */
+		int hits; /**< number of index sets found in the cache */
+		int misses; /**< number of created index sets */
+		bool registered; /**< clear() was registered to be called in PetscFinalize */
+
+	public:
+		PetscVectorISCache();
+
+		/** @brief Get stride index set.
+		*
+		*  Find the index set in the cache or create new one and store it in the cache.
+		*
+		*  @note collective if the communicator does not have inner Petsc communicator yet
+		*  @param user_comm communicator of the vector
+		*  @param begin first index
+		*  @param end last index
+		*  @param stride step between indices
+		*  @return index set with new reference, has to be destroyed by the caller
+		*/
+		IS get_stride(MPI_Comm user_comm, int begin, int end, int stride);
+
+		/** @brief Destroy all cached index sets.
+		*/
+		void clear();
+
+		/** @brief Get number of index sets found in the cache.
+		*/
+		int get_hits() const;
+
+		/** @brief Get number of index sets which had to be created.
+		*/
+		int get_misses() const;
+};
+
+PetscVectorISCache ISCACHE_PETSCVECTOR; /**< index sets of subvectors used by all vectors */
+
+/** \struct PetscVectorPoolItem
+ *  \brief Inner vector stored in the pool together with its layout.
+ *
+*/
+struct PetscVectorPoolItem {
+	Vec vec; /**< stored vector */
+	PetscInt size; /**< global size */
+	PetscInt local_size; /**< local size */
+	PetscInt block_size; /**< block size */
+	MPI_Comm comm; /**< communicator */
+	VecType type; /**< type of the vector */
+};
+
+/** \class PetscVectorPool
+ *  \brief Pool of inner vectors for recycling of temporaries.
+ *
+ *  The inner vectors of destroyed vectors are not destroyed, but they are stored in the pool.
+ *  New vector with the same layout (global size, ownership ranges of all processes, block size, communicator and type) takes
+ *  the stored one instead of calling VecDuplicate. The values of such vector are not set.
+ *  All processes of the communicator store the vector together (or destroy it together), therefore they take 
+ *  the same vector from the pool and create new vectors together. POOL_MODE_PETSCVECTOR has to be the same on all processes.
+ *  Pool is emptied in PetscFinalize, global instance is POOL_PETSCVECTOR.
+*/
+class PetscVectorPool {
+	private:
+		PetscVectorPoolItem items[PETSCVECTOR_POOLSIZE]; /**< stored vectors, the last one is reused first */
+		int items_size; /**< number of stored vectors */
+		int hits; /**< number of checkouts served from the pool */
+		int misses; /**< number of checkouts with VecDuplicate */
+		int drops; /**< number of vectors destroyed because the pool was full */
+		bool registered; /**< clear() was registered to be called in PetscFinalize */
+
+		/** @brief Get the layout of the vector.
+		*
+		*  @param vec vector
+		*  @param item the layout is stored here (vector is not)
+		*/
+		static void get_layout(Vec vec, PetscVectorPoolItem *item);
+
+		/** @brief Compare ownership ranges of two vectors.
+		*
+		*  @param vec1 first vector
+		*  @param vec2 second vector
+		*  @param comm communicator of both vectors
+		*  @return true if all processes own the same components of both vectors
+		*/
+		static bool same_ranges(Vec vec1, Vec vec2, MPI_Comm comm);
+
+	public:
+		PetscVectorPool();
+
+		/** @brief Get the vector with the same layout as given one.
+		*
+		*  Take the vector from the pool or create new one by VecDuplicate if there is not any suitable.
+		*  The values of the vector are not set.
+		*
+		*  @param layout vector with required layout
+		*  @param vec new vector
+		*/
+		void checkout(Vec layout, Vec *vec);
+
+		/** @brief Return the vector to the pool.
+		*
+		*  The vector is stored in the pool if the pool is enabled (POOL_MODE_PETSCVECTOR), 
+		*  it is not full and nobody else holds the reference to the vector on any process; otherwise it is destroyed.
+		*
+		*  @note collective on the communicator of the vector (as VecDestroy)
+		*  @param vec returned vector, it is NULL afterwards
+		*/
+		void checkin(Vec *vec);
+
+		/** @brief Destroy all stored vectors.
+		*/
+		void clear();
+
+		/** @brief Get number of vectors in the pool.
+		*/
+		int get_size() const;
+
+		/** @brief Get number of checkouts served from the pool.
+		*/
+		int get_hits() const;
+
+		/** @brief Get number of checkouts which had to create new vector.
+		*/
+		int get_misses() const;
+
+		/** @brief Get number of returned vectors which were destroyed because the pool was full.
+		*/
+		int get_drops() const;
+
+		/** @brief Set all statistics to zero.
+		*/
+		void reset_stats();
+};
+
+/** \class PetscVectorLayout
+ *  \brief Parallel layout of vectors.
+ *
+ *  Communicator, global size and ownership ranges of all processes. The vectors created from the same layout
+ *  are distributed in the same way, therefore they could be combined in linear combinations.
+*/
+class PetscVectorLayout {
+	private:
+		MPI_Comm comm; /**< communicator */
+		int global_size; /**< global size */
+		int nproc; /**< number of processes in communicator */
+		int rank; /**< rank of this process in communicator */
+		int *ranges; /**< ownership ranges of all processes (nproc+1 values), NULL if the layout is empty */
+
+	public:
+
+		/** @brief The basic constructor.
+		*
+		*  Empty layout without any communicator.
+		*/
+		PetscVectorLayout();
+
+		/** @brief Create constructor.
+		*
+		*  Collective, the ownership ranges are gathered from all processes.
+		*
+		*  @param n global size, could be PETSC_DECIDE if local_size is given
+		*  @param local_size local size, PETSC_DECIDE to split the global size uniformly (as VecSetSizes)
+		*  @param comm communicator
+		*/
+		PetscVectorLayout(int n, int local_size = PETSC_DECIDE, MPI_Comm comm = PETSC_COMM_WORLD);
+
+		/** @brief Constructor from Vec.
+		*
+		*  Take the layout of existing vector.
+		*
+		*  @param vec vector
+		*/
+		PetscVectorLayout(Vec vec);
+
+		PetscVectorLayout(const PetscVectorLayout &layout);
+		PetscVectorLayout &operator=(const PetscVectorLayout &layout);
+		~PetscVectorLayout();
+
+		/** @brief Get communicator of the layout.
+		*/
+		MPI_Comm get_comm() const;
+
+		/** @brief Get global size.
+		*/
+		int size() const;
+
+		/** @brief Get size of the part owned by this process.
+		*/
+		int local_size() const;
+
+		/** @brief Get ownership range of this process.
+		*
+		*  @param low first owned index
+		*  @param high one more than the last owned index
+		*/
+		void get_ownership(int *low, int *high) const;
+
+		/** @brief Get ownership ranges of all processes.
+		*
+		*  @return array of nproc+1 values, the process r owns indices ranges[r] to ranges[r+1]-1
+		*/
+		const int *get_ranges() const;
+
+		/** @brief Compare layouts.
+		*
+		*  Layouts are same if they have congruent communicators and same ownership ranges.
+		*/
+		bool operator==(const PetscVectorLayout &layout) const;
+		bool operator!=(const PetscVectorLayout &layout) const;
+};
+
+PetscVectorPool POOL_PETSCVECTOR; /**< pool of inner vectors used by all vectors */
 
 /** \class PetscVector
  *  \brief General class for manipulation with vectors.
@@ -62,7 +473,68 @@ class PetscVectorWrapperMul;
 */
 class PetscVector {
 	private:
-		Vec inner_vector; /**< original Petsc Vector */
+		mutable Vec inner_vector; /**< original Petsc Vector, could be replaced by its own copy if it is shared */
+		mutable bool shared; /**< inner vector could be shared with copies of this vector (copy-on-write mode) */
+		mutable bool poolable; /**< inner vector was created by this class and could be returned to the pool */
+		void *mapped_data; /**< memory mapped file with the array of inner vector (load_local_mapped), otherwise NULL */
+		size_t mapped_size; /**< size of mapped file */
+		bool view; /**< inner vector is the column of multivector, it could not be shared or given to other vector */
+
+		mutable int layout_size; /**< cached global size of inner vector, -1 if it was not read yet */
+		mutable int layout_local_size; /**< cached local size of inner vector */
+		mutable int layout_low; /**< cached first owned index */
+		mutable int layout_high; /**< cached one more than the last owned index */
+
+		mutable bool values_dirty; /**< some values were set by set(int,double) and the vector was not assembled yet */
+		mutable bool values_updating; /**< VecAssemblyBegin was called, VecAssemblyEnd is pending */
+		InsertMode values_mode; /**< insert mode of the values which were not assembled yet */
+
+		/** @brief Get stride index set of subvector.
+		*
+		*  Find the index set in the global cache ISCACHE_PETSCVECTOR or create new one and store it in the cache.
+		*
+		*  @param begin first index
+		*  @param end last index
+		*  @param stride step between indices
+		*  @return index set with new reference, has to be destroyed by the caller
+		*/
+		IS get_stride_is(int begin, int end, int stride) const;
+
+		/** @brief Get own inner vector before the change of values.
+		*
+		*  If the inner vector is shared with other copies of this vector, then the inner vector is duplicated and the values are copied.
+		*/
+		void unshare() const;
+
+		/** @brief Get assembled inner vector to be read inside the library.
+		*
+		*  Unlike get_vector, the inner vector stays shared with the copies of this vector (copy-on-write mode),
+		*  therefore its values must not be changed.
+		*/
+		Vec get_vector_shared() const;
+
+		/** @brief Read sizes and ownership range of inner vector.
+		*
+		*  The sizes are read from Petsc only once, every change of inner vector clears them.
+		*/
+		void cache_layout() const;
+
+		/** @brief Destroy inner vector.
+		*
+		*  Return inner vector to the pool or destroy it and unmap the file with values.
+		*/
+		void destroy_inner_vector();
+
+		/** @brief Set values with given insert mode.
+		*
+		*  Common part of set and add, the vector is assembled before the change of insert mode.
+		*
+		*  @param n number of values
+		*  @param indices global indices of components
+		*  @param values new values
+		*  @param mode INSERT_VALUES or ADD_VALUES
+		*/
+		void set_values(int n, const int *indices, const double *values, InsertMode mode);
 		
 	public:
 
@@ -77,9 +549,18 @@ class PetscVector {
 		*
 		*  Create new vector of given size n.
 		*
-		*  @param n global size of new vector
+		*  @param n global size of new vector, could be PETSC_DECIDE if local_size is given
+		*  @param local_size size of the part owned by this process, PETSC_DECIDE to split the global size uniformly
+		*/ 
+		PetscVector(int n, int local_size = PETSC_DECIDE);
+
+		/** @brief Create constructor.
+		*
+		*  Create new vector with given layout, all vectors with the same layout are distributed in the same way.
+		*
+		*  @param layout communicator, global size and ownership ranges of new vector
 		*/ 
-		PetscVector(int n);
+		PetscVector(const PetscVectorLayout &layout);
 
 		/** @brief Create constructor.
 		*
@@ -93,11 +574,20 @@ class PetscVector {
 		/** @brief Duplicate constructor.
 		*
 		*  Create new vector by duplicating given one.
+		*  In copy-on-write mode (COPY_ON_WRITE_PETSCVECTOR), the inner vector is shared and duplicated before the first change of any copy.
 		*
 		*  @param vec original vector to be duplicated
 		*/ 
 		PetscVector(const PetscVector &vec1);
 
+		/** @brief Move constructor.
+		*
+		*  Take the inner vector from given temporary vector, no new Vec is created.
+		*
+		*  @param vec original vector, it is empty afterwards
+		*/ 
+		PetscVector(PetscVector &&vec);
+
 		/** @brief Constructor from Vec.
 		*
 		*  Construct new vector from given Vec.
@@ -114,6 +604,14 @@ class PetscVector {
 		*/ 
 		PetscVector(const PetscVectorWrapperComb &comb);
 
+		/** @brief Constructor from pointwise division.
+		*
+		*  Creates a new vector with the result of pointwise division.
+		*
+		*  @param div pointwise division
+		*/ 
+		PetscVector(const PetscVectorWrapperDiv &div);
+
 		/** @brief Destructor.
 		*
 		*  If inner vector is present, then destroy it using VecDestroy.
@@ -123,11 +621,27 @@ class PetscVector {
 
 		/** @brief Update values in inner vector.
 		*
-		*  Calls VecAssemblyBegin and VecAssemblyEnd.
+		*  Calls VecAssemblyBegin and VecAssemblyEnd if there are values set by set(int,double) which were not assembled yet,
+		*  otherwise does nothing. It is called automatically before every operation which reads the values.
 		*
 		*/
 		void valuesUpdate() const;
 
+		/** @brief Start the update of values in inner vector.
+		*
+		*  Calls VecAssemblyBegin if there are values which were not assembled yet.
+		*  The communication could be overlapped with local work, the update is finished by valuesUpdateEnd or by the next operation with the vector.
+		*
+		*/
+		void valuesUpdateBegin() const;
+
+		/** @brief Finish the update of values in inner vector.
+		*
+		*  Calls VecAssemblyEnd if valuesUpdateBegin was called before.
+		*
+		*/
+		void valuesUpdateEnd() const;
+
 		/** @brief Scale all values in inner vector.
 		*
 		*  Call VecScale.
@@ -138,6 +652,8 @@ class PetscVector {
 
 		/** @brief Get inner vector.
 		*
+		*  The inner vector will be used outside, therefore it is assembled and in copy-on-write mode it is not shared with copies anymore.
+		*
 		*  @return original inner vector
 		*  @todo this function is temporary
 		*/ 
@@ -145,6 +661,8 @@ class PetscVector {
 
 		/** @brief Get size of inner vector.
 		*
+		*  The size is cached, Petsc is asked only for the first time.
+		*
 		*  @return global size of inner vector
 		*  @todo control if inner_vector was allocated
 		*/ 
@@ -152,11 +670,21 @@ class PetscVector {
 
 		/** @brief Get local size of inner vector.
 		*
+		*  The size is cached, Petsc is asked only for the first time.
+		*
 		*  @return local size of inner vector
 		*  @todo control if inner_vector was allocated
 		*/ 
 		int local_size() const;
 
+		/** @brief Get layout of inner vector.
+		*
+		*  Layout could be used to create new vectors which are distributed in the same way.
+		*
+		*  @return communicator, global size and ownership ranges of inner vector
+		*/ 
+		PetscVectorLayout get_layout() const;
+
 		/** @brief Get single value.
 		*
 		*  Return single value with given index of component.
@@ -169,13 +697,13 @@ class PetscVector {
 		
 		/** @brief Get ownership of global vector.
 		*
-		*  Call VecGetOwnershipRange, get the indeces of local components.
+		*  Get the indeces of local components, the range is cached (VecGetOwnershipRange is called only for the first time).
 		* 
 		*  @param low start index
 		*  @param high end index + 1
 		*  @todo control if inner_vector was allocated
 		*/ 
-		void get_ownership(int *low, int *high);
+		void get_ownership(int *low, int *high) const;
 
 		/** @brief Get local array from vector.
 		*
@@ -209,13 +737,39 @@ class PetscVector {
 		/** @brief Update value in inner vector.
 		*
 		*  Set one specific component of the vector to given value, this function is called from overloaded operator.
+		*  The vector is not assembled immediately, the values are assembled once before the next operation with the vector.
 		*
+		*  @note has to be called on all processes (with any index), otherwise the assembly could not be collective
 		*  @param index index of component
 		*  @param new_value new value of component
 		*  @todo control if inner_vector was allocated
 		*/ 
 		void set(int index, double new_value);
 
+		/** @brief Update values in inner vector.
+		*
+		*  Set given components of the vector to given values with one VecSetValues call.
+		*  The stash for values owned by other processes is preallocated and the vector is assembled once before the next operation with the vector.
+		*
+		*  @note has to be called on all processes (with any number of indices), otherwise the assembly could not be collective
+		*  @param n number of components
+		*  @param indices global indices of components
+		*  @param new_values new values of components
+		*/
+		void set(int n, const int *indices, const double *new_values);
+
+		/** @brief Add values to inner vector.
+		*
+		*  Add given values to given components of the vector, the contributions with the same index are summed.
+		*  The stash for values owned by other processes is preallocated and the vector is assembled once before the next operation with the vector.
+		*
+		*  @note has to be called on all processes (with any number of indices), otherwise the assembly could not be collective
+		*  @param n number of components
+		*  @param indices global indices of components
+		*  @param values values to be added
+		*/
+		void add(int n, const int *indices, const double *values);
+
 		/** @brief Load values from file to PETSC_COMM_SELF.
 		*
 		*  Uses PetscViewerBinaryOpen, PETSC_COMM_SELF.
@@ -225,6 +779,20 @@ class PetscVector {
 		*/ 
 		void load_local(std::string filename);
 
+		/** @brief Load values from file to PETSC_COMM_SELF without copying.
+		*
+		*  The file in PETSc binary format is mapped to memory (private mapping) and the mapped values are 
+		*  used as the array of the vector, similarly to PetscVector(double*,int). The file is unmapped in destructor.
+		*  The bytes are swapped only if the file is not in native byte order, otherwise the pages are read on demand
+		*  and shared with other processes which map the same file (until they are changed).
+		*  PETSc (save_binary, save_binary_async) writes big-endian files, on little-endian hosts all their values are swapped,
+		*  therefore the whole file is read and copied to private pages of every process. Files written by save_binary_native
+		*  are mapped without copying.
+		*
+		*  @param filename name of file with values
+		*/ 
+		void load_local_mapped(std::string filename);
+
 		/** @brief Load values from file to PETSC_COMM_WORLD.
 		*
 		*  Uses PetscViewerBinaryOpen, PETSC_COMM_WORLD.
@@ -234,6 +802,19 @@ class PetscVector {
 		*/ 
 		void load_global(std::string filename);
 
+		/** @brief Load values from file in PETSc binary format using MPI-IO.
+		*
+		*  The header is read by the first process and broadcasted, afterwards every process reads only 
+		*  the bytes of its own components (collective MPI_File_read_at_all) directly to the local array.
+		*  If the vector is not allocated, then it is created on PETSC_COMM_WORLD with given local size,
+		*  otherwise the layout of existing vector is used and the size in file has to be the same.
+		*
+		*  @note collective
+		*  @param filename name of file with values
+		*  @param local_size number of components owned by this process, PETSC_DECIDE by default
+		*/ 
+		void load_parallel(std::string filename, int local_size = PETSC_DECIDE);
+
 		/** @brief Save vector to file in PETSc binary format
 		*
 		*  Uses PetscViewerBinaryOpen, PETSC_COMM_WORLD.
@@ -243,6 +824,30 @@ class PetscVector {
 		*/ 
 		void save_binary(std::string filename);
 
+		/** @brief Save vector to file in PETSc binary layout in native byte order.
+		*
+		*  The header and the values are stored in the byte order of this host, every process writes its own part of the file
+		*  using MPI-IO (collective MPI_File_write_at_all). On big-endian hosts the file is the same as the one of save_binary,
+		*  on little-endian hosts it could be loaded only by load_local_mapped (without swapping and copying the values).
+		*
+		*  @note collective
+		*  @param filename name of file
+		*/ 
+		void save_binary_native(std::string filename) const;
+
+		/** @brief Save vector to file in PETSc binary format in the background.
+		*
+		*  The local values are copied (in big-endian byte order) to the staging buffer and written 
+		*  to their part of the file by the background thread (pwrite), therefore the vector could be changed immediately.
+		*  At most PETSCVECTOR_CHECKPOINTS checkpoints are in progress, otherwise the oldest one is finished at first.
+		*  The staging buffers are reused by next checkpoints.
+		*
+		*  @note collective, the file system has to be shared by all processes
+		*  @param filename name of file
+		*  @return checkpoint handle, its wait() has to be called to be sure that the file is complete
+		*/ 
+		PetscVectorCheckpoint save_binary_async(std::string filename) const;
+
 		/** @brief Save vector to file in PETSc ASCII format
 		*
 		*  Uses PetscViewerASCIIOpen, PETSC_COMM_WORLD.
@@ -252,38 +857,105 @@ class PetscVector {
 		*/ 
 		void save_ascii(std::string filename);
 
-		/** @brief Assignment operator.
+		/** @brief Save vector to text file in parallel.
 		*
-		*  Copy values from one vector to another.
-		*  If the inner vector does not exist, then duplicate the vector at first.
+		*  Every process formats its local components (one value per line, in global order) and writes them 
+		*  to its own part of the file using MPI-IO. The offsets are computed from the lengths of local texts (MPI_Exscan),
+		*  therefore nothing is sent to the first process.
 		*
-		*  @param x vector with new values
+		*  @note collective
+		*  @param filename name of file
 		*/ 
-		PetscVector &operator=(const PetscVector &x);
+		void save_ascii_parallel(std::string filename) const;
 
-		/** @brief Assignment operator.
+		/** @brief Print vector in global order.
 		*
-		*  Set all values in the vector equal to given one.
+		*  The local arrays are sent to the first process in chunks of PETSCVECTOR_PRINTCHUNK components 
+		*  and printed one after another, therefore the whole vector is never stored on one process.
+		*  If head is not negative, then only head first and tail last components are printed.
 		*
-		*  @param alpha new value
-		*  @todo give error if inner_vector does not exist
+		*  @note collective, the output is written only on the first process
+		*  @param output output stream
+		*  @param head number of first components to be printed, negative to print all components
+		*  @param tail number of last components to be printed
 		*/ 
-		PetscVector &operator=(double alpha);
+		void print(std::ostream &output, int head = -1, int tail = 0) const;
 
-		/** @brief Assignment operator.
+		/** @brief Print summary of vector.
 		*
-		*  Set values of the vector equal to the result from linear combination.
-		*  If the inner vector does not exist, then duplicate the vector at first.
+		*  Print size, minimum, maximum, sum and norm of vector and the values of components 
+		*  sampled with constant step (including the first and the last one).
 		*
-		*  @param comb linear combination
+		*  @note collective, the output is written only on the first process
+		*  @param output output stream
+		*  @param samples number of sampled components
 		*/ 
-		PetscVector &operator=(PetscVectorWrapperComb comb);
+		void print_summary(std::ostream &output, int samples = 10) const;
+
+		/** @brief Assignment operator.
+		*
+		*  Copy values from one vector to another.
+		*  If the inner vector does not exist, then duplicate the vector at first.
+		*
+		*  @param x vector with new values
+		*/ 
+		PetscVector &operator=(const PetscVector &x);
+
+		/** @brief Move assignment operator.
+		*
+		*  Destroy the inner vector and take the inner vector of given temporary vector, the values are not copied.
+		*
+		*  @param x vector with new values, it is empty afterwards
+		*/ 
+		PetscVector &operator=(PetscVector &&x);
+
+		/** @brief Swap two vectors.
+		*
+		*  Exchange the inner vectors (and their state), no values are copied and nothing is allocated.
+		*
+		*  @param x vector to exchange with
+		*/ 
+		void swap(PetscVector &x);
+		friend void swap(PetscVector &x, PetscVector &y);
+
+		friend class PetscMultiVector;
+		friend class PetscVectorWrapperSub;
+		friend class PetscVectorWrapperCombNode;
+		friend class PetscVectorReduction;
+
+		/** @brief Assignment operator.
+		*
+		*  Set all values in the vector equal to given one.
+		*
+		*  @param alpha new value
+		*  @todo give error if inner_vector does not exist
+		*/ 
+		PetscVector &operator=(double alpha);
+
+		/** @brief Assignment operator.
+		*
+		*  Set values of the vector equal to the result from linear combination.
+		*  If the inner vector does not exist, then duplicate the vector at first.
+		*
+		*  @param comb linear combination
+		*/ 
+		PetscVector &operator=(const PetscVectorWrapperComb &comb);
 
 		PetscVector &operator=(PetscVectorWrapperMul mul);
 
+		/** @brief Assignment operator.
+		*
+		*  Set values of the vector equal to the result of pointwise division, the result is written directly to this vector.
+		*  If the inner vector does not exist, then duplicate the vector at first.
+		*
+		*  @param div pointwise division
+		*/ 
+		PetscVector &operator=(const PetscVectorWrapperDiv &div);
+
 		friend void operator*=(PetscVector &vec1, double alpha);
-		friend void operator+=(const PetscVector &vec1, const PetscVectorWrapperComb comb);
-		friend void operator-=(PetscVector &vec1, const PetscVectorWrapperComb comb);
+		friend void operator+=(PetscVector &vec1, const PetscVectorWrapperComb &comb);
+		friend void operator-=(PetscVector &vec1, const PetscVectorWrapperComb &comb);
+		friend void operator-=(PetscVector &vec1, PetscVectorWrapperComb &&comb);
 
 		/** @brief Get subvector.
 		*
@@ -324,11 +996,11 @@ class PetscVector {
 
 		/** @brief Stream insertion operator.
 		*
-		*  Prints the content of inner_vector.
+		*  Prints the content of inner_vector by print(), i.e. in global order on the first process.
 		*
+		*  @note collective
 		*  @param output output stream
 		*  @param vector instance of PetscVector to be printed
-		*  @todo print local portion of the vector
 		*/ 
 		friend std::ostream &operator<<(std::ostream &output, const PetscVector &vector);
 
@@ -343,8 +1015,57 @@ class PetscVector {
 		*/ 
 		friend double dot(const PetscVector &x, const PetscVector &y);
 
-		friend double dot(const PetscVector &x, const PetscVectorWrapperSub y);
-		friend double dot(const PetscVectorWrapperSub x, const PetscVector &y);
+		friend double dot(const PetscVector &x, const PetscVectorWrapperSub &y);
+		friend double dot(const PetscVectorWrapperSub &x, const PetscVector &y);
+
+		/** @brief Compute all dot products of two groups of vectors.
+		*
+		*  The local products are computed in one sweep through the arrays (in blocks of PETSCVECTOR_BLOCKSIZE components)
+		*  and reduced by one MPI_Allreduce.
+		*  \f[\mathrm{result}_{i+jk} = \langle x_i,y_j \rangle\f]
+		*
+		*  @param k number of vectors in the first group
+		*  @param x first group
+		*  @param l number of vectors in the second group
+		*  @param y second group
+		*  @param result k x l matrix stored by columns
+		*/ 
+		friend void block_dot(int k, const PetscVector * const *x, int l, const PetscVector * const *y, double *result);
+
+		/** @brief Compute Gram matrix of the group of vectors.
+		*
+		*  Symmetric variant of block_dot, only the upper triangle is computed and reduced.
+		*
+		*  @param k number of vectors
+		*  @param x group of vectors
+		*  @param result symmetric k x k matrix (both triangles are set)
+		*/ 
+		friend void gram(int k, const PetscVector * const *x, double *result);
+
+		/** @brief Orthogonalize the group of vectors against orthonormal basis.
+		*
+		*  Block classical Gram-Schmidt with reorthogonalization (CGS2), v = v - Q*(Q^T*v) is performed twice.
+		*  Every pass needs one global reduction (block_dot), the update goes through the arrays once.
+		*
+		*  @param k number of basis vectors
+		*  @param q orthonormal basis
+		*  @param l number of orthogonalized vectors
+		*  @param v orthogonalized vectors, they are changed
+		*  @param r k x l matrix of coefficients (sum of both passes) stored by columns, could be NULL
+		*/ 
+		friend void cgs2(int k, const PetscVector * const *q, int l, PetscVector * const *v, double *r);
+
+		/** @brief Tall-skinny QR factorization of the group of vectors.
+		*
+		*  The local parts are factorized by LAPACK geqrf, the triangular factors of all processes are gathered
+		*  (one MPI_Allgather) and factorized again. The vectors are replaced by orthonormal Q, v = Q*R,
+		*  the diagonal of R is not negative.
+		*
+		*  @param l number of vectors
+		*  @param v vectors, they are replaced by orthonormal vectors
+		*  @param r upper triangular l x l matrix stored by columns, could be NULL
+		*/ 
+		friend void tsqr(int l, PetscVector * const *v, double *r);
 
 
 		/** @brief Get the maximum value in vector.
@@ -379,14 +1100,16 @@ class PetscVector {
 
 		/** @brief Pointwise divide of two vectors.
 		*
-		*  Divide values of the inner vector by components of input vector.
-		*  \f[ x_i = \frac{x_i}{y_i}, ~~\forall i = 0, \dots, size-1 \f]
+		*  Returns the wrapper, the division is performed in the assignment directly to the result.
+		*  \f[ z_i = \frac{x_i}{y_i}, ~~\forall i = 0, \dots, size-1 \f]
+		*  uses Petsc function VecPointwiseDivide(Vec w, Vec x,Vec y) 
 		*
 		*  @param x vector
 		*  @param y vector
-		*  @todo this function is really strange 
 		*/ 
-		friend const PetscVector operator/(const PetscVector &x, const PetscVector &y);
+		friend PetscVectorWrapperDiv operator/(const PetscVector &x, const PetscVector &y);
+		friend PetscVectorWrapperDiv operator/(const PetscVector &x, const PetscVectorWrapperSub &y);
+		friend PetscVectorWrapperDiv operator/(const PetscVectorWrapperSub &x, const PetscVector &y);
 
 		/** @brief Compute pointwise multiplication.
 		*
@@ -400,25 +1123,195 @@ class PetscVector {
 		*/ 
 		friend PetscVectorWrapperMul mul(const PetscVector &x, const PetscVector &y);
 
+		/** @brief Elementwise absolute value.
+		*
+		*  Returns the combination with one node, the values are computed in the assignment.
+		*  \f[ z_i = |x_i| \f]
+		*
+		*  @param x vector
+		*/ 
+		friend PetscVectorWrapperComb abs(const PetscVector &x);
+
+		/** @brief Elementwise square root.
+		*
+		*  Returns the combination with one node, the values are computed in the assignment.
+		*  Same as Petsc function VecSqrtAbs, i.e. the square root of absolute values.
+		*  \f[ z_i = \sqrt{|x_i|} \f]
+		*
+		*  @param x vector
+		*/ 
+		friend PetscVectorWrapperComb sqrt(const PetscVector &x);
+
+		/** @brief Elementwise exponential.
+		*
+		*  Returns the combination with one node, the values are computed in the assignment.
+		*  \f[ z_i = e^{x_i} \f]
+		*
+		*  @param x vector
+		*/ 
+		friend PetscVectorWrapperComb exp(const PetscVector &x);
+
+		/** @brief Elementwise minimum and maximum of two vectors.
+		*
+		*  Returns the combination with one node, the values are computed in the assignment.
+		*  \f[ z_i = \min \lbrace x_i, y_i \rbrace, ~~ z_i = \max \lbrace x_i, y_i \rbrace \f]
+		*
+		*  @param x first vector
+		*  @param y second vector
+		*/ 
+		friend PetscVectorWrapperComb min(const PetscVector &x, const PetscVector &y);
+		friend PetscVectorWrapperComb max(const PetscVector &x, const PetscVector &y);
+
+};
+
+
+/** \enum PetscVectorWrapperCombNodeType
+ *  \brief Elementwise operations of nodes in PetscVectorWrapperComb.
+*/
+enum PetscVectorWrapperCombNodeType {
+	COMB_NODE_VECTOR = 0, /**< x_i (or 1 if the vector is NULL) */
+	COMB_NODE_MUL = 1, /**< x_i*z_i */
+	COMB_NODE_DIV = 2, /**< x_i/z_i (zero if z_i is zero, as VecPointwiseDivide) */
+	COMB_NODE_ABS = 3, /**< |x_i| */
+	COMB_NODE_SQRT = 4, /**< square root of |x_i| (as VecSqrtAbs) */
+	COMB_NODE_EXP = 5, /**< exp(x_i) */
+	COMB_NODE_MIN = 6, /**< min(x_i,z_i) */
+	COMB_NODE_MAX = 7 /**< max(x_i,z_i) */
+};
+
+/*! \class PetscVectorWrapperComb
+    \brief Wrapper with one node in the linear combinations.
+
+*/
+class PetscVectorWrapperCombNode
+{
+	private:
+		Vec inner_vector; /**< pointer to vector (original Petsc Vec) in linear combination */
+		Vec inner_vector2; /**< second operand of binary elementwise operation, otherwise NULL */
+		PetscVectorWrapperCombNodeType type; /**< elementwise operation applied to the vectors */
+		double coeff; /**< coefficient in linear combination */
+
+	public:
+		/* constructors and destructor */
+		PetscVectorWrapperCombNode();
+		PetscVectorWrapperCombNode(const PetscVector &vec);
+		PetscVectorWrapperCombNode(double new_coeff, Vec new_vector);
+		PetscVectorWrapperCombNode(double new_coeff );
+
+		/** @brief Constructor of elementwise operation.
+		*
+		*  The node represents coeff*op(x_i,z_i), the second vector is used only by binary operations.
+		*
+		*  @param new_coeff coefficient in linear combination
+		*  @param new_type elementwise operation
+		*  @param new_vector first operand
+		*  @param new_vector2 second operand (or NULL)
+		*/
+		PetscVectorWrapperCombNode(double new_coeff, PetscVectorWrapperCombNodeType new_type, Vec new_vector, Vec new_vector2);
+
+		~PetscVectorWrapperCombNode();
+
+
+		/* general functions */
+		void set_vector(Vec new_vector);
+		Vec get_vector() const;
+		Vec get_vector2() const;
+		PetscVectorWrapperCombNodeType get_type() const;
+		int get_size() const;
+		double get_value(int index) const;
+
+		/** @brief Evaluate the elementwise operation of the node.
+		*
+		*  Apply the operation of the node to the components of operands (without coefficient).
+		*
+		*  @param type elementwise operation
+		*  @param x component of the first vector
+		*  @param z component of the second vector (ignored by unary operations)
+		*  @return op(x,z)
+		*/
+		static double evaluate(PetscVectorWrapperCombNodeType type, double x, double z);
+		
+		void set_coeff(double new_coeff);
+		void scale(double alpha);
+		double get_coeff() const;
+
+
+
 };
 
 
 /** \class PetscVectorWrapperComb
  *  \brief Wrapper to allow linear combinations of vectors.
  *
- *  The linear combination of vector is stored in the list of PetscVectorWrapperComb.
+ *  The linear combination of vector is stored in the array of PetscVectorWrapperCombNode.
+ *  First PETSCVECTOR_COMBSIZE nodes are stored inside the object, therefore the usual (short) combinations 
+ *  are created, passed through operators and computed without any allocation.
  *  Finally, using the assignment operator in PetscVector, function compute() is called.
 */
 class PetscVectorWrapperComb
 {
 	private:
-		std::list<PetscVectorWrapperCombNode> comb_list; /**< the list of linear combination nodes */
-		int vector_size; /**< stores the global size of the last added vector */
+		PetscVectorWrapperCombNode inline_nodes[PETSCVECTOR_COMBSIZE]; /**< storage of the first nodes of linear combination */
+		PetscVectorWrapperCombNode *allocated_nodes; /**< storage of nodes if the combination is longer than PETSCVECTOR_COMBSIZE, otherwise NULL */
+		int nodes_size; /**< number of nodes in linear combination */
+		int nodes_capacity; /**< number of nodes which could be stored without reallocation */
+		mutable int vector_size; /**< global size of the vectors, -1 if it was not read yet, 0 if there is not any vector */
+
+		/** @brief Get the array with nodes.
+		* 
+		*  @return inline storage or allocated storage of nodes
+		*/
+		PetscVectorWrapperCombNode *get_nodes();
+		const PetscVectorWrapperCombNode *get_nodes() const;
+
+		/** @brief Prepare the storage for given number of nodes.
+		* 
+		*  If the inline storage is not sufficient, then the nodes are moved to allocated storage.
+		* 
+		*  @param new_capacity number of nodes
+		*/
+		void reserve(int new_capacity);
+
+		/** @brief Perform prepared linear combination in one sweep.
+		* 
+		*  Compute y = scale*y + shift + sum(alphas*vectors) + sum(coeff*op(x,z)) block after block through the local arrays,
+		*  therefore the result is read and written only once.
+		*  The elementwise nodes of the block are evaluated before the result is changed, so they could use the result as an operand.
+		*  The kernel is not used if the local sizes do not match or the arrays of the vectors overlap with the result.
+		* 
+		*  @param y result
+		*  @param scale coefficient of the result
+		*  @param shift scalar value added to all components
+		*  @param maxpy_length number of vectors in the combination (without the result)
+		*  @param alphas coefficients of the vectors
+		*  @param vectors the vectors in the combination
+		*  @param elementwise_length number of nodes with elementwise operation
+		*  @param elementwise the nodes with elementwise operation
+		*  @return true if the combination was computed, false if it has to be computed using Petsc functions
+		*/
+		bool compute_fused(Vec y, double scale, double shift, int maxpy_length, const PetscScalar *alphas, const Vec *vectors, int elementwise_length, const PetscVectorWrapperCombNode * const *elementwise) const;
+
+		/** @brief Perform prepared linear combination using Petsc functions.
+		* 
+		*  Compute y = scale*y + shift + sum(alphas*vectors) using VecScale, VecShift and VecMAXPY,
+		*  i.e. the result is swept up to three times.
+		*  The elementwise nodes are evaluated into temporary vectors (before the result is changed) and added by one more VecMAXPY.
+		* 
+		*  @param y result
+		*  @param scale coefficient of the result
+		*  @param shift scalar value added to all components
+		*  @param maxpy_length number of vectors in the combination (without the result)
+		*  @param alphas coefficients of the vectors
+		*  @param vectors the vectors in the combination
+		*  @param elementwise_length number of nodes with elementwise operation
+		*  @param elementwise the nodes with elementwise operation
+		*/
+		void compute_petsc(Vec y, double scale, double shift, int maxpy_length, PetscScalar *alphas, Vec *vectors, int elementwise_length, const PetscVectorWrapperCombNode * const *elementwise) const;
 		
 	public:
 		/** @brief The basic constructor.
 		* 
-		*  @todo deprecated - there is no reason to create empty combination
+		*  Create empty combination.
 		*/
 		PetscVectorWrapperComb();
 
@@ -447,19 +1340,62 @@ class PetscVectorWrapperComb
 		* 
 		*  @param subvec the subvector in linear combination
 		*/
-		PetscVectorWrapperComb(PetscVectorWrapperSub subvec);
+		PetscVectorWrapperComb(const PetscVectorWrapperSub &subvec);
 
-		/** @brief Destructor.
+		/** @brief Constructor from pointwise multiplication.
+		* 
+		*  The product mul(x,y) is added to the combination as one elementwise node, 
+		*  therefore it is evaluated in the same sweep as the rest of the combination.
+		* 
+		*  @param mulinstance pointwise multiplication
+		*/
+		PetscVectorWrapperComb(const PetscVectorWrapperMul &mulinstance);
+
+		/** @brief Constructor from pointwise division.
+		* 
+		*  The quotient x/y is added to the combination as one elementwise node.
+		* 
+		*  @param div pointwise division
+		*/
+		PetscVectorWrapperComb(const PetscVectorWrapperDiv &div);
+
+		/** @brief Copy constructor.
+		* 
+		*  Copy the nodes, allocate the storage only if the combination is long.
+		* 
+		*  @param comb original combination
+		*/
+		PetscVectorWrapperComb(const PetscVectorWrapperComb &comb);
+
+		/** @brief Move constructor.
 		* 
-		*  Destroy the list with linear combination nodes.
+		*  Take the allocated storage of given combination (if there is any).
+		* 
+		*  @param comb original combination, it is empty afterwards
+		*/
+		PetscVectorWrapperComb(PetscVectorWrapperComb &&comb);
+
+		/** @brief Destructor.
 		* 
-		*  @todo how to destroy the list? element after element?
+		*  Free the allocated storage of nodes (if there is any).
 		*/
 		~PetscVectorWrapperComb();
 
+		/** @brief Copy assignment.
+		* 
+		*  @param comb original combination
+		*/
+		PetscVectorWrapperComb &operator=(const PetscVectorWrapperComb &comb);
+
+		/** @brief Move assignment.
+		* 
+		*  @param comb original combination, it is empty afterwards
+		*/
+		PetscVectorWrapperComb &operator=(PetscVectorWrapperComb &&comb);
+
 		/** @brief Get number of nodes in linear combination.
 		* 
-		*  Get the size of inner list of linear combination nodes.
+		*  Get the number of linear combination nodes.
 		* 
 		*  @return number of nodes in linear combination
 		*/
@@ -467,7 +1403,7 @@ class PetscVectorWrapperComb
 
 		/** @brief Get the dimension of vectors.
 		* 
-		*  Get the size of the last added vector.
+		*  Get the size of the first vector in combination, it is read only once (not during append).
 		* 
 		*  @return size of the vector
 		*/
@@ -481,11 +1417,11 @@ class PetscVectorWrapperComb
 		*  @return vector
 		*  @todo private?
 		*/
-		Vec get_first_vector();
+		Vec get_first_vector() const;
 		
 		/** @brief Append node to linear combination.
 		* 
-		*  Append new node to the existing list of linear combination nodes.
+		*  Append new node to the end of existing linear combination nodes.
 		* 
 		*  @param node new node to be appended
 		*/
@@ -493,146 +1429,239 @@ class PetscVectorWrapperComb
 
 		/** @brief Merge with given combination.
 		* 
-		*  Merge two lists with linear combinations.
+		*  Append the nodes of the second combination.
 		*  
 		*  @param comb the second combinations
 		*/
 		void merge(const PetscVectorWrapperComb &comb);
 
+		/** @brief Scale all nodes.
+		* 
+		*  Multiply the coefficients of all nodes by given scalar.
+		*  
+		*  @param alpha scalar
+		*/
+		void scale(double alpha);
+
 		/** @brief Perform the linear combination.
 		* 
 		*  Perform the linear combination and store result in given vector.
+		*  If FUSED_MODE_PETSCVECTOR is set, then the fused kernel is used whenever possible.
 		*  init_scale = 0 if the method was called from operator=
 		*  init_scale = 1 if the method was called from operator+=
 		* 
 		*  @param y result
 		*  @param init_scale initial scale of the result vector
 		*/
-		void compute(const Vec &y, double init_scale);
+		void compute(const Vec &y, double init_scale) const;
 		
-		/* print */
-		friend std::ostream &operator<<(std::ostream &output, PetscVectorWrapperComb comb);
+		/** @brief Stream insertion operator.
+		*
+		*  Computes the combination into temporary vector (from the pool) and prints it by print().
+		*
+		*  @note collective
+		*  @param output output stream
+		*  @param comb linear combination
+		*/
+		friend std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperComb &comb);
 
 		/** @brief Scale.
 		* 
 		*  Scale all coefficients of nodes in the linear combination.
+		*  If the combination is temporary, then it is scaled in place and moved to the result.
 		*  
 		*  @param alpha scalar
 		*  @param comb linear combination to be scaled
 		*/
-		friend const PetscVectorWrapperComb operator*(double alpha, PetscVectorWrapperComb comb);
+		friend PetscVectorWrapperComb operator*(double alpha, const PetscVectorWrapperComb &comb);
+		friend PetscVectorWrapperComb operator*(double alpha, PetscVectorWrapperComb &&comb);
 
 		/** @brief Addition operator.
 		* 
 		*  Add one combination to another.
+		*  If the first combination is temporary, then the nodes are appended to it and it is moved to the result.
 		*  
 		*  @param comb1 first linear combination
 		*  @param comb2 second linear combination
 		*/
-		friend const PetscVectorWrapperComb operator+(PetscVectorWrapperComb comb1, PetscVectorWrapperComb comb2);
+		friend PetscVectorWrapperComb operator+(const PetscVectorWrapperComb &comb1, const PetscVectorWrapperComb &comb2);
+		friend PetscVectorWrapperComb operator+(PetscVectorWrapperComb &&comb1, const PetscVectorWrapperComb &comb2);
 
 		/** @brief Subtraction operator.
 		* 
 		*  Substract one combination from another, i.e. scale the second one with -1.0 and perform addition.
+		*  If the first combination is temporary, then the nodes are appended to it and it is moved to the result.
 		*  
 		*  @param comb1 first linear combination
 		*  @param comb2 second linear combination
 		*/
-		friend const PetscVectorWrapperComb operator-(PetscVectorWrapperComb comb1, PetscVectorWrapperComb comb2);
+		friend PetscVectorWrapperComb operator-(const PetscVectorWrapperComb &comb1, const PetscVectorWrapperComb &comb2);
+		friend PetscVectorWrapperComb operator-(PetscVectorWrapperComb &&comb1, const PetscVectorWrapperComb &comb2);
 
-		friend const PetscVectorWrapperComb operator+(PetscVectorWrapperComb comb1, double scalar);
-		friend const PetscVectorWrapperComb operator+(double scalar,PetscVectorWrapperComb comb2);
+		friend PetscVectorWrapperComb operator+(const PetscVectorWrapperComb &comb1, double scalar);
+		friend PetscVectorWrapperComb operator+(PetscVectorWrapperComb &&comb1, double scalar);
+		friend PetscVectorWrapperComb operator+(double scalar, const PetscVectorWrapperComb &comb2);
+		friend PetscVectorWrapperComb operator+(double scalar, PetscVectorWrapperComb &&comb2);
 
 };
 
 
-/*! \class PetscVectorWrapperComb
-    \brief Wrapper with one node in the linear combinations.
+/*! \class PetscVectorWrapperSub
+    \brief Wrapper with subvectors.
 
+	For manipulation with subvectors. Based on Petsc function GetSubvector (in constructor) and RestoreSubVector (in destructor).
+	The slices y(i) and y(begin,end) are replicated, every process has all their components. If the slice is owned by one process,
+	then the subvector of this process is a view to the array of original vector (without copying) and the other processes get 
+	the values by one MPI_Bcast, their changes are not written back. The slices which cross the boundary of processes 
+	and general index sets are scattered by VecGetSubVector (the values are copied in and out).
+	The subvector could be moved, but not copied (it would be restored twice).
+	Subvector with all components (i.e. vec(all)) is an alias of the original vector without any index set.
 */
-class PetscVectorWrapperCombNode
+class PetscVectorWrapperSub
 {
 	private:
-		Vec inner_vector; /**< pointer to vector (original Petsc Vec) in linear combination */
-		double coeff; /**< coefficient in linear combination */
+		IS subvector_is; /**< the index set of subvector, NULL if the subvector is an alias of original vector */
+		mutable Vec inner_vector; /**< original vector */
+		mutable Vec subvector; /**< subvector (created by VecGetSubVector), NULL if it was moved */
+		const PetscVector *owner; /**< vector which owns the original vector, NULL if it is not known */
+		int view_rank; /**< the process which owns the whole slice (the subvector is a view), -1 if VecGetSubVector is used */
+		mutable PetscScalar *view_array; /**< array of original vector of view_rank or the copy of values on other processes */
+		mutable Vec shared_inner_vector; /**< original vector shared with copies of the owner before unshare(), referenced until destructor */
+		mutable Vec shared_subvector; /**< subvector of shared_inner_vector, it could be still used by nodes of combinations */
+		mutable PetscScalar *shared_view_array; /**< view_array of shared_subvector */
 
-	public:
-		/* constructors and destructor */
-		PetscVectorWrapperCombNode();
-		PetscVectorWrapperCombNode(const PetscVector &vec);
-		PetscVectorWrapperCombNode(double new_coeff, Vec new_vector);
-		PetscVectorWrapperCombNode(double new_coeff );
+		bool free_is; /**< free index set in destructor or not */
+		bool replicated; /**< every process has all components of the subvector (slices) */
 
-		~PetscVectorWrapperCombNode();
+		/** @brief Get own original vector before the change of values.
+		*
+		*  If the original vector is shared with copies of the owner (copy-on-write mode), then the owner gets its own copy 
+		*  and the subvector is taken from this copy. The old subvector could be already used by the nodes of combination 
+		*  on the right side of the assignment, therefore it is restored in destructor. Read-only subvectors stay shared.
+		*/
+		void unshare() const;
 
+		/** @brief Restore the subvector of shared original vector kept by unshare().
+		*/
+		void release_shared() const;
 
-		/* general functions */
-		void set_vector(Vec new_vector);
-		Vec get_vector() const;
-		int get_size() const;
-		int get_value(int index) const;
-		
-		void set_coeff(double new_coeff);
-		void scale(double alpha);
-		double get_coeff() const;
+		/** @brief Find the process which owns the whole slice.
+		*
+		*  @return rank of the process, -1 if the index set is not contiguous stride or the slice is owned by more processes
+		*/
+		int get_view_rank() const;
 
+		/** @brief Get subvector of given original vector.
+		*
+		*  Create the view (if view_rank is not negative) or call VecGetSubVector.
+		*
+		*  @note collective
+		*  @param vec original vector
+		*  @param sub new subvector
+		*  @param array the array of view (or its copy on other processes), NULL if VecGetSubVector was used
+		*/
+		void get_subvector_of(Vec vec, Vec *sub, PetscScalar **array) const;
 
+		/** @brief Restore subvector of given original vector.
+		*
+		*  @note collective
+		*  @param vec original vector
+		*  @param sub restored subvector
+		*  @param array the array of view
+		*/
+		void restore_subvector_of(Vec vec, Vec *sub, PetscScalar **array) const;
 
-};
+	public:
 
-/*! \class PetscVectorWrapperSub
-    \brief Wrapper with subvectors.
+		/** @brief The vector is a view to the array of original vector (created by this wrapper).
+		*
+		*  @param vec vector (could be NULL)
+		*/
+		static bool is_view(Vec vec);
 
-	For manipulation with subvectors. Based on Petsc function GetSubvector (in constructor) and RestoreSubVector (in destructor).
-*/
-class PetscVectorWrapperSub
-{
-	private:
-		IS subvector_is; /**< the index set of subvector */
-		Vec inner_vector; /**< original vector */
-		Vec subvector; /**< subvector (created by VecGetSubVector) */
+		/** @brief Compare the slices of two views.
+		*
+		*  The views of the same original vector could share the array. The slices are the same on all processes
+		*  (also on the processes with the copies of values), therefore all of them get the same answer.
+		*
+		*  @param vec1 first vector (could be NULL)
+		*  @param vec2 second vector (could be NULL)
+		*  @return 1 if they are views of the same slice, 2 if the slices overlap, 0 otherwise
+		*/
+		static int compare_views(Vec vec1, Vec vec2);
 
-		bool free_is; /**< free index set in destructor or not */
+		/** @brief Constructor of subvector.
+		*
+		*  @param inner_vector original vector
+		*  @param subvector_is index set of subvector
+		*  @param new_free_is destroy the index set in destructor
+		*  @param new_owner vector which owns the original vector
+		*  @param new_replicated the index set is the same on all processes (slices), the view could be used
+		*/
+		PetscVectorWrapperSub(Vec inner_vector, IS subvector_is, bool new_free_is, const PetscVector *new_owner = NULL, bool new_replicated = false);
 
-	public:
+		/** @brief Constructor of alias.
+		*
+		*  The subvector with all components is the original vector itself, no index set is created.
+		*
+		*  @param inner_vector original vector
+		*  @param new_owner vector which owns the original vector
+		*/
+		PetscVectorWrapperSub(Vec inner_vector, const PetscVector *new_owner = NULL);
+
+		/** @brief Move constructor.
+		*
+		*  The subvector is restored only by the new wrapper.
+		*
+		*  @param subvec the subvector to take
+		*/
+		PetscVectorWrapperSub(PetscVectorWrapperSub &&subvec);
+		PetscVectorWrapperSub(const PetscVectorWrapperSub &subvec) = delete;
 
-		PetscVectorWrapperSub(Vec inner_vector, IS subvector_is, bool new_free_is);
 		~PetscVectorWrapperSub();
 
 		void valuesUpdate() const;
 		void scale(PetscScalar alpha) const;
 
 		void set(double new_value);		
-		Vec get_subvector();
+		Vec get_subvector() const;
 
-		double get(int index);
+		double get(int index) const;
 
-		/* print */
+		/** @brief Stream insertion operator.
+		*
+		*  Prints the components with their indices in original vector in global order on the first process.
+		*
+		*  @note collective
+		*  @param output output stream
+		*  @param wrapper subvector to be printed
+		*/
 		friend std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperSub &wrapper);				
 
 		/* assignment operator */
-		PetscVectorWrapperSub &operator=(PetscVectorWrapperSub subvec); /* subvec = subvec */
+		PetscVectorWrapperSub &operator=(const PetscVectorWrapperSub &subvec); /* subvec = subvec */
 		PetscVectorWrapperSub &operator=(double scalar_value);	 /* subvec = const */
 		PetscVectorWrapperSub &operator=(const PetscVector &vec2); /* subvec = vec */
-		PetscVectorWrapperSub &operator=(PetscVectorWrapperComb comb);	
+		PetscVectorWrapperSub &operator=(const PetscVectorWrapperComb &comb);	
 
 		friend void operator*=(const PetscVectorWrapperSub &subvec1, double alpha); /* subvec = alpha*subvec */
-		friend void operator+=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperComb comb);
-		friend void operator-=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperComb comb);
-		friend void operator/=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub subvec2);
+		friend void operator+=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperComb &comb);
+		friend void operator-=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperComb &comb);
+		friend void operator-=(const PetscVectorWrapperSub &subvec1, PetscVectorWrapperComb &&comb);
+		friend void operator/=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2);
 
 		/* boolean operations */
-		friend bool operator==(PetscVectorWrapperSub subvec1, double alpha);
-		friend bool operator==(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2);
+		friend bool operator==(const PetscVectorWrapperSub &subvec1, double alpha);
+		friend bool operator==(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2);
 
-		friend bool operator>(PetscVectorWrapperSub vec1, PetscVectorWrapperSub vec2);
+		friend bool operator>(const PetscVectorWrapperSub &vec1, const PetscVectorWrapperSub &vec2);
 
 		/* binary operations */
-		friend double sum(const PetscVectorWrapperSub subvec1);
-		friend double dot(const PetscVectorWrapperSub subvec1, const PetscVectorWrapperSub subvec2);
+		friend double sum(const PetscVectorWrapperSub &subvec1);
+		friend double dot(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2);
 
-		friend double dot(const PetscVector &x, const PetscVectorWrapperSub y);
-		friend double dot(const PetscVectorWrapperSub x, const PetscVector &y);
+		friend double dot(const PetscVector &x, const PetscVectorWrapperSub &y);
+		friend double dot(const PetscVectorWrapperSub &x, const PetscVector &y);
 
 
 		/** @brief Compute pointwise multiplication.
@@ -645,7 +1674,28 @@ class PetscVectorWrapperSub
 		*  @param y second vector
 		*  @todo control if inner_vectors were allocated
 		*/ 
-		friend PetscVectorWrapperMul mul(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2);
+		friend PetscVectorWrapperMul mul(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2);
+
+		/** @brief Pointwise divide of two subvectors.
+		*
+		*  Returns the wrapper, the division is performed in the assignment directly to the result.
+		*
+		*  @param x first subvector
+		*  @param y second subvector
+		*/ 
+		friend PetscVectorWrapperDiv operator/(const PetscVector &x, const PetscVectorWrapperSub &y);
+		friend PetscVectorWrapperDiv operator/(const PetscVectorWrapperSub &x, const PetscVector &y);
+		friend PetscVectorWrapperDiv operator/(const PetscVectorWrapperSub &x, const PetscVectorWrapperSub &y);
+
+		/** @brief Assignment operator.
+		*
+		*  Set values of the subvector equal to the result of pointwise division.
+		*
+		*  @param div pointwise division
+		*/ 
+		PetscVectorWrapperSub &operator=(const PetscVectorWrapperDiv &div);
+
+		friend class PetscVectorReduction;
 
 };
 
@@ -678,15 +1728,678 @@ class PetscVectorWrapperMul
 		
 };
 
+/*! \class PetscVectorWrapperDiv
+    \brief Wrapper for manipulation with v1/v2.
+
+	The pointwise division is not performed until the wrapper is assigned, then the result is written directly to the target vector.
+*/
+class PetscVectorWrapperDiv
+{
+	private:
+		Vec inner_vector1; /**< dividend */
+		Vec inner_vector2; /**< divisor */
+	public:
+
+		PetscVectorWrapperDiv(Vec inner_vector1, Vec inner_vector2);
+		~PetscVectorWrapperDiv();
+
+		/** @brief Compute pointwise division.
+		*
+		*  \f[\mathrm{result}_i = \frac{x_i}{y_i} \f]
+		*  uses Petsc function VecPointwiseDivide(Vec w, Vec x,Vec y), result could be one of the operands
+		* 
+		*  @param result output vector
+		*/ 
+		void div(Vec result) const;
+
+		Vec get_vector1() const;
+		Vec get_vector2() const;
+
+		/** @brief Stream insertion operator.
+		*
+		*  Computes the division into temporary vector and prints it by print().
+		*
+		*  @note collective
+		*  @param output output stream
+		*  @param div pointwise division
+		*/ 
+		friend std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperDiv &div);
+		
+};
+
+/** \enum PetscVectorReductionType
+ *  \brief Types of reductions in PetscVectorReduction.
+*/
+enum PetscVectorReductionType {
+	REDUCTION_DOT = 0, /**< sum of x_i*y_i */
+	REDUCTION_NORM = 1, /**< sum of x_i*x_i, square root is computed after the reduction */
+	REDUCTION_SUM = 2, /**< sum of x_i */
+	REDUCTION_MAX = 3, /**< maximum of x_i */
+	REDUCTION_MIN = 4 /**< maximum of -x_i, the sign is changed after the reduction */
+};
+
+/** \struct PetscVectorReductionItem
+ *  \brief One reduction in PetscVectorReduction.
+*/
+struct PetscVectorReductionItem {
+	PetscVectorReductionType type; /**< type of reduction */
+	Vec x; /**< first operand (referenced until the local value is computed), NULL if the local value was already computed */
+	Vec y; /**< second operand of dot product (referenced as well) */
+	PetscObjectState x_state; /**< state of the first operand when the reduction was added */
+	PetscObjectState y_state; /**< state of the second operand when the reduction was added */
+	double value; /**< local value of reduction */
+	double *result; /**< where to store the global value */
+};
+
+/** \class PetscVectorReduction
+ *  \brief Batch of reductions computed with one MPI_Allreduce.
+ *
+ *  The reductions (dot, norm, sum, max, min) are added to the batch and computed together by compute().
+ *  The local values of all reductions with PetscVector operands are computed in one sweep through local arrays,
+ *  then all global values are obtained by one MPI_Allreduce. 
+ *  The PetscVector operands are referenced until their local values are computed, therefore temporaries (like x+y) could be used,
+ *  but the operands should not be changed before compute() (it is reported as an error).
+ *  The reductions with subvectors are computed locally at once, since the subvector could be destroyed before compute().
+ *  The results are available after compute(). All operands have to be of the same (or congruent) communicator.
+ *  The global reduction could be split into compute_begin() and compute_end() (using MPI_Iallreduce if MPI-3 is available)
+ *  to overlap the communication with other work.
+*/
+class PetscVectorReduction {
+	private:
+		PetscVectorReductionItem inline_items[PETSCVECTOR_REDUCTIONSIZE]; /**< storage of the first reductions */
+		PetscVectorReductionItem *allocated_items; /**< storage of reductions if there are more than PETSCVECTOR_REDUCTIONSIZE, otherwise NULL */
+		int items_size; /**< number of reductions in batch */
+		int items_capacity; /**< number of reductions which could be stored without reallocation */
+		MPI_Comm comm; /**< communicator of operands */
+
+		double buffer_inline[2*PETSCVECTOR_REDUCTIONSIZE]; /**< pairs (value, type) sent to the global reduction */
+		double *buffer; /**< buffer_inline or allocated buffer for longer batches */
+		MPI_Request request; /**< request of the global reduction in progress */
+		bool computing; /**< compute_begin() was called, compute_end() was not called yet */
+
+		/** @brief Store the results of finished global reduction.
+		*
+		*  Set the results and empty the batch.
+		*/
+		void finish();
+
+		PetscVectorReduction(const PetscVectorReduction &reduction); /* batch could not be copied */
+		PetscVectorReduction &operator=(const PetscVectorReduction &reduction);
+
+		/** @brief Get the array of reductions.
+		*
+		*  @return allocated_items if allocated, otherwise inline_items
+		*/
+		PetscVectorReductionItem *get_items();
+
+		/** @brief Prepare space for given number of reductions.
+		*
+		*  @param new_capacity required number of reductions
+		*/
+		void reserve(int new_capacity);
+
+		/** @brief Add new reduction to the batch.
+		*
+		*  If the operands are subvectors, then the local value is computed at once, otherwise the operands are referenced.
+		*  The communicator of operands is compared with the communicator of the batch.
+		*
+		*  @param type type of reduction
+		*  @param x first operand
+		*  @param y second operand (only for dot product, otherwise NULL)
+		*  @param now compute the local value at once
+		*  @param result where to store the global value
+		*/
+		void append(PetscVectorReductionType type, Vec x, Vec y, bool now, double *result);
+
+		/** @brief Compute local value of reduction on part of arrays.
+		*
+		*  @param type type of reduction
+		*  @param x array of first operand
+		*  @param y array of second operand (only for dot product)
+		*  @param begin first local index
+		*  @param end last local index + 1
+		*  @param value local value to be updated
+		*/
+		static void reduce_local(PetscVectorReductionType type, const double *x, const double *y, int begin, int end, double *value);
+
+		/** @brief Compute local values of all reductions with PetscVector operands.
+		*
+		*  All arrays are processed in blocks of PETSCVECTOR_BLOCKSIZE components, 
+		*  the shared operands are read only once.
+		*/
+		void compute_local();
+
+	public:
+
+		/** @brief The basic constructor.
+		*
+		*  Create empty batch.
+		*/
+		PetscVectorReduction();
+
+		/** @brief Destructor.
+		*
+		*  Free the storage of reductions and release the operands. The reductions which were not computed are lost.
+		*/
+		~PetscVectorReduction();
+
+		/** @brief Get number of reductions in batch.
+		*
+		*  @return number of reductions which were not computed yet
+		*/
+		int get_size() const;
+
+		/** @brief Add dot product to the batch.
+		*
+		*  \f[\mathrm{result} = \langle x,y \rangle = \sum\limits_{i = 0}^{size-1} x_i y_i\f]
+		*
+		*  @param x first vector
+		*  @param y second vector
+		*  @param result where to store the result after compute()
+		*/
+		void dot(const PetscVector &x, const PetscVector &y, double *result);
+		void dot(const PetscVector &x, const PetscVectorWrapperSub &y, double *result);
+		void dot(const PetscVectorWrapperSub &x, const PetscVector &y, double *result);
+		void dot(const PetscVectorWrapperSub &x, const PetscVectorWrapperSub &y, double *result);
+
+		/** @brief Add 2-norm to the batch.
+		*
+		*  \f[\mathrm{result} = \Vert x \Vert_2 = \sqrt{\sum\limits_{i = 0}^{size-1} x_i^2} \f]
+		*
+		*  @param x vector
+		*  @param result where to store the result after compute()
+		*/
+		void norm(const PetscVector &x, double *result);
+		void norm(const PetscVectorWrapperSub &x, double *result);
+
+		/** @brief Add the sum of components to the batch.
+		*
+		*  \f[\mathrm{result} = \sum\limits_{i = 0}^{size-1} x_i \f]
+		*
+		*  @param x vector
+		*  @param result where to store the result after compute()
+		*/
+		void sum(const PetscVector &x, double *result);
+		void sum(const PetscVectorWrapperSub &x, double *result);
+
+		/** @brief Add the maximum value to the batch.
+		*
+		*  \f[\mathrm{result} = \max \lbrace x_i, i = 0, \dots size-1 \rbrace\f]
+		*
+		*  @param x vector
+		*  @param result where to store the result after compute()
+		*/
+		void max(const PetscVector &x, double *result);
+		void max(const PetscVectorWrapperSub &x, double *result);
+
+		/** @brief Add the minimum value to the batch.
+		*
+		*  \f[\mathrm{result} = \min \lbrace x_i, i = 0, \dots size-1 \rbrace\f]
+		*
+		*  @param x vector
+		*  @param result where to store the result after compute()
+		*/
+		void min(const PetscVector &x, double *result);
+		void min(const PetscVectorWrapperSub &x, double *result);
+
+		/** @brief Compute all reductions in batch.
+		*
+		*  Compute local values and call one MPI_Allreduce, then store the results and empty the batch.
+		*  Has to be called on all processes of the communicator.
+		*/
+		void compute();
+
+		/** @brief Start the computation of all reductions in batch.
+		*
+		*  Compute local values and start the global reduction with MPI_Iallreduce.
+		*  The operands could be changed after this call, the results are stored by compute_end().
+		*  Nothing could be added to the batch until compute_end() is called.
+		*  Has to be called on all processes of the communicator.
+		*/
+		void compute_begin();
+
+		/** @brief Finish the computation of all reductions in batch.
+		*
+		*  Wait for the global reduction, then store the results and empty the batch.
+		*/
+		void compute_end();
+
+		/** @brief Test if the computation of reductions is finished.
+		*
+		*  If the global reduction started by compute_begin() is finished, then store the results and empty the batch.
+		*
+		*  @return true if there is no reduction in progress
+		*/
+		bool compute_test();
+		
+};
+
+/** \class PetscMultiVector
+ *  \brief Block of vectors with the same layout.
+ *
+ *  Local parts of all K columns are stored in one array, one after another (padded to PETSCVECTOR_MULTIPAD scalars).
+ *  Every column is available as PetscVector, which could be used in linear combinations and subvectors.
+ *  The operations over all columns (mdot, norms, maxpy, axpy) go through the array once and perform at most one global reduction.
+ *  The multivector could not be copied, columns should not be swapped or moved away (their values are copied instead).
+*/
+class PetscMultiVector {
+	private:
+		int columns_size; /**< number of columns */
+		int leading_size; /**< distance between the beginnings of columns in the array */
+		int local_length; /**< local size of every column */
+		MPI_Comm comm; /**< communicator of columns */
+		PetscScalar *array; /**< local parts of all columns, aligned to PETSCVECTOR_MULTIPAD scalars */
+		PetscScalar *array_allocated; /**< allocated memory which contains the array */
+		PetscVector *columns; /**< columns created on the array */
+
+		/** @brief Allocate the array and create columns.
+		*
+		*  @param layout layout of columns
+		*  @param k number of columns
+		*/
+		void allocate(const PetscVectorLayout &layout, int k);
+
+		/** @brief Assemble values which were set in columns and were not assembled yet.
+		*/
+		void values_update() const;
+
+		PetscMultiVector(const PetscMultiVector &multivector); /* the array could not be copied */
+		PetscMultiVector &operator=(const PetscMultiVector &multivector);
+
+	public:
+
+		/** @brief Create constructor.
+		*
+		*  Collective, the values are not set.
+		*
+		*  @param layout layout of every column
+		*  @param k number of columns
+		*/
+		PetscMultiVector(const PetscVectorLayout &layout, int k);
+
+		/** @brief Create constructor.
+		*
+		*  Columns have the same layout as given vector, the values are not set.
+		*
+		*  @param vec vector with the layout of columns
+		*  @param k number of columns
+		*/
+		PetscMultiVector(const PetscVector &vec, int k);
+
+		/** @brief Destructor.
+		*
+		*  Destroy columns and free the array.
+		*/
+		~PetscMultiVector();
+
+		/** @brief Get number of columns.
+		*/
+		int get_columns() const;
+
+		/** @brief Get global size of columns.
+		*/
+		int size() const;
+
+		/** @brief Get local size of columns.
+		*/
+		int local_size() const;
+
+		/** @brief Get column.
+		*
+		*  @param j index of column
+		*  @return vector with the values stored in the array of multivector
+		*/
+		PetscVector &operator()(int j);
+		const PetscVector &operator()(int j) const;
+
+		/** @brief Set all values of all columns.
+		*
+		*  @param value new value
+		*/
+		void set(double value);
+
+		/** @brief Dot products of all columns with given vector.
+		*
+		*  Like VecMDot, the local products are computed in one sweep through the array and reduced by one MPI_Allreduce.
+		*
+		*  @param y vector with the layout of columns
+		*  @param result array of K results
+		*/
+		void mdot(const PetscVector &y, double *result) const;
+
+		/** @brief Norms of all columns.
+		*
+		*  NORM_2 of all columns with one MPI_Allreduce.
+		*
+		*  @param result array of K results
+		*/
+		void norms(double *result) const;
+
+		/** @brief Add linear combination of columns to the vector.
+		*
+		*  Like VecMAXPY, y = y + sum{alpha_j*x_j} in one sweep through the array, y should not be the column of this multivector.
+		*
+		*  @param y updated vector with the layout of columns
+		*  @param alpha array of K coefficients
+		*/
+		void maxpy(PetscVector &y, const double *alpha) const;
+
+		/** @brief Add multiples of the vector to all columns.
+		*
+		*  x_j = x_j + alpha_j*y for all columns in one sweep through the array, y should not be the column of this multivector.
+		*
+		*  @param alpha array of K coefficients
+		*  @param y vector with the layout of columns
+		*/
+		void axpy(const double *alpha, const PetscVector &y);
+
+		/** @brief Compute all dot products of columns of two multivectors.
+		*
+		*  The local products are computed by one BLAS gemm on the arrays and reduced by one MPI_Allreduce.
+		*
+		*  @param x first multivector with k columns
+		*  @param y second multivector with l columns
+		*  @param result k x l matrix stored by columns
+		*/
+		friend void block_dot(const PetscMultiVector &x, const PetscMultiVector &y, double *result);
+
+		/** @brief Compute Gram matrix of columns.
+		*
+		*  Only the upper triangle is reduced.
+		*
+		*  @param x multivector with k columns
+		*  @param result symmetric k x k matrix
+		*/
+		friend void gram(const PetscMultiVector &x, double *result);
+
+		/** @brief Orthogonalize columns against orthonormal columns of other multivector.
+		*
+		*  CGS2 with BLAS gemm for the local products and updates, two global reductions.
+		*
+		*  @param q multivector with k orthonormal columns
+		*  @param v multivector with l columns, they are changed
+		*  @param r k x l matrix of coefficients stored by columns, could be NULL
+		*/
+		friend void cgs2(const PetscMultiVector &q, PetscMultiVector &v, double *r);
+
+		/** @brief Tall-skinny QR factorization of columns.
+		*
+		*  The local part is factorized in place in the array, one MPI_Allgather.
+		*
+		*  @param v multivector with l columns, they are replaced by orthonormal columns
+		*  @param r upper triangular l x l matrix stored by columns, could be NULL
+		*/
+		friend void tsqr(PetscMultiVector &v, double *r);
+};
+
+/** \class PetscVectorFuture
+ *  \brief Result of reduction which is computed in the background.
+ *
+ *  Returned by dot_async, norm_async, sum_async and max_async. The local value is computed immediately,
+ *  the global reduction is in progress until get() is called, therefore other operations could be performed in the meantime.
+ *  The future could be moved, but not copied.
+*/
+class PetscVectorFuture {
+	private:
+		/** \struct PetscVectorFutureState
+		 *  \brief Batch with one reduction and its result, allocated on heap to keep the address during the reduction.
+		*/
+		struct PetscVectorFutureState {
+			PetscVectorReduction reduction; /**< batch with one reduction in progress */
+			double value; /**< result of the reduction */
+		};
+
+		PetscVectorFutureState *state; /**< state of reduction, NULL if the future was moved */
+
+		PetscVectorFuture(const PetscVectorFuture &future); /* future could not be copied */
+		PetscVectorFuture &operator=(const PetscVectorFuture &future);
+
+	public:
+		/** @brief Constructor of new future.
+		*
+		*  The reduction should be added to get_reduction() and started by compute_begin().
+		*/
+		PetscVectorFuture();
+
+		/** @brief Move constructor.
+		*
+		*  @param future the future to take the reduction from
+		*/
+		PetscVectorFuture(PetscVectorFuture &&future);
+
+		/** @brief Destructor.
+		*
+		*  If the reduction is still in progress, then wait for it.
+		*/
+		~PetscVectorFuture();
+
+		/** @brief Move assignment.
+		*
+		*  @param future the future to take the reduction from
+		*/
+		PetscVectorFuture &operator=(PetscVectorFuture &&future);
+
+		/** @brief Get batch of the future.
+		*
+		*  @return batch for one reduction
+		*/
+		PetscVectorReduction &get_reduction();
+
+		/** @brief Get the address of the result.
+		*
+		*  @return the address where the result of reduction has to be stored
+		*/
+		double *get_result();
+
+		/** @brief Test if the result is ready.
+		*
+		*  @return true if the global reduction is finished
+		*/
+		bool ready();
+
+		/** @brief Get the result.
+		*
+		*  Wait for the global reduction if it is still in progress.
+		*  The future which was moved from reports an error and returns zero.
+		*
+		*  @return result of the reduction
+		*/
+		double get();
+};
+
+/** @brief Start the computation of dot product.
+*
+*  Computes the local value and starts the global reduction, the result is obtained by get() of returned future.
+*  \f[\mathrm{result} = \langle x,y \rangle = \sum\limits_{i = 0}^{size-1} x_i y_i\f]
+*
+*  @param x first vector
+*  @param y second vector
+*/
+PetscVectorFuture dot_async(const PetscVector &x, const PetscVector &y);
+PetscVectorFuture dot_async(const PetscVector &x, const PetscVectorWrapperSub &y);
+PetscVectorFuture dot_async(const PetscVectorWrapperSub &x, const PetscVector &y);
+PetscVectorFuture dot_async(const PetscVectorWrapperSub &x, const PetscVectorWrapperSub &y);
+
+/** @brief Start the computation of 2-norm.
+*
+*  Computes the local value and starts the global reduction, the result is obtained by get() of returned future.
+*
+*  @param x vector
+*/
+PetscVectorFuture norm_async(const PetscVector &x);
+PetscVectorFuture norm_async(const PetscVectorWrapperSub &x);
+
+/** @brief Start the computation of the sum of components.
+*
+*  Computes the local value and starts the global reduction, the result is obtained by get() of returned future.
+*
+*  @param x vector
+*/
+PetscVectorFuture sum_async(const PetscVector &x);
+PetscVectorFuture sum_async(const PetscVectorWrapperSub &x);
+
+/** @brief Start the computation of the maximum value.
+*
+*  Computes the local value and starts the global reduction, the result is obtained by get() of returned future.
+*
+*  @param x vector
+*/
+PetscVectorFuture max_async(const PetscVector &x);
+PetscVectorFuture max_async(const PetscVectorWrapperSub &x);
+
+/** \struct PetscVectorCheckpointSlot
+ *  \brief Staging buffer and background writer of one asynchronous checkpoint.
+*/
+struct PetscVectorCheckpointSlot {
+	std::thread writer; /**< background thread which writes the buffer */
+	std::atomic<bool> done; /**< the writer finished */
+	bool busy; /**< the writer was started and it was not joined yet */
+	long long generation; /**< number of checkpoint which uses the slot */
+	int error; /**< errno of failed write, 0 if the write was successful */
+
+	PetscScalar *buffer; /**< local values in big-endian byte order */
+	size_t capacity; /**< allocated size of buffer (number of values) */
+	size_t count; /**< number of values to be written */
+	long long offset; /**< position of the values in file (bytes) */
+	long long file_size; /**< size of whole file, set by the first process */
+	bool write_header; /**< the first process writes the header */
+	PetscInt header[2]; /**< class id and global size in big-endian byte order */
+	std::string filename; /**< name of file */
+};
+
+/** \class PetscVectorCheckpointQueue
+ *  \brief Bounded set of asynchronous checkpoints in progress.
+ *
+ *  Global instance is CHECKPOINTS_PETSCVECTOR, the writers are finished and the buffers are freed in PetscFinalize.
+*/
+class PetscVectorCheckpointQueue {
+	private:
+		PetscVectorCheckpointSlot slots[PETSCVECTOR_CHECKPOINTS]; /**< checkpoints, used in round-robin order */
+		int next; /**< slot of the next checkpoint, it contains the oldest one */
+		long long generation; /**< number of started checkpoints */
+		std::map<long long,int> failed; /**< errno of failed checkpoints whose slots were already reused */
+		bool registered; /**< clear() was registered to be called in PetscFinalize */
+
+		/** @brief Body of background thread, write the buffer of the slot.
+		*
+		*  @param slot slot with prepared buffer
+		*/
+		static void write(PetscVectorCheckpointSlot *slot);
+
+	public:
+		PetscVectorCheckpointQueue();
+
+		/** @brief Destructor.
+		*
+		*  Wait for the writers (if PetscFinalize was not called) and free the buffers.
+		*/
+		~PetscVectorCheckpointQueue();
+
+		/** @brief Start new checkpoint of local values.
+		*
+		*  Wait for the oldest checkpoint if all slots are used and for older checkpoints to the same file,
+		*  copy the values to the staging buffer and start the writer.
+		*
+		*  @param filename name of file
+		*  @param values local values
+		*  @param count number of local values
+		*  @param low global index of the first local value
+		*  @param global_size global size of vector
+		*  @param write_header write the header and set the size of file
+		*  @return generation of the checkpoint, the slot is (generation-1) modulo PETSCVECTOR_CHECKPOINTS
+		*/
+		long long start(std::string filename, const PetscScalar *values, int count, PetscInt low, PetscInt global_size, bool write_header);
+
+		/** @brief Test if the checkpoint is written.
+		*
+		*  @param checkpoint_generation generation of checkpoint
+		*  @return true if the local part was written
+		*/
+		bool ready(long long checkpoint_generation);
+
+		/** @brief Wait for the local part of checkpoint.
+		*
+		*  @param checkpoint_generation generation of checkpoint
+		*  @return errno of failed write, 0 if the write was successful
+		*/
+		int join(long long checkpoint_generation);
+
+		/** @brief Wait for all checkpoints and free the staging buffers.
+		*/
+		void clear();
+};
+
+PetscVectorCheckpointQueue CHECKPOINTS_PETSCVECTOR; /**< asynchronous checkpoints of all vectors */
+
+/** \class PetscVectorCheckpoint
+ *  \brief Handle of asynchronous checkpoint.
+ *
+ *  Returned by PetscVector::save_binary_async. The checkpoint could be moved, but not copied.
+ *  The destructor does not wait, the writer is finished by next checkpoints or in PetscFinalize.
+*/
+class PetscVectorCheckpoint {
+	private:
+		long long generation; /**< generation of checkpoint in CHECKPOINTS_PETSCVECTOR, 0 if there is not any */
+		MPI_Comm comm; /**< communicator of saved vector */
+
+		PetscVectorCheckpoint(const PetscVectorCheckpoint &checkpoint); /* checkpoint could not be copied */
+		PetscVectorCheckpoint &operator=(const PetscVectorCheckpoint &checkpoint);
+
+	public:
+		/** @brief Constructor of handle.
+		*
+		*  @param new_generation generation of started checkpoint
+		*  @param new_comm communicator of saved vector
+		*/
+		PetscVectorCheckpoint(long long new_generation, MPI_Comm new_comm);
+
+		/** @brief Move constructor.
+		*
+		*  @param checkpoint the handle to take the checkpoint from
+		*/
+		PetscVectorCheckpoint(PetscVectorCheckpoint &&checkpoint);
+
+		/** @brief Move assignment.
+		*
+		*  @param checkpoint the handle to take the checkpoint from
+		*/
+		PetscVectorCheckpoint &operator=(PetscVectorCheckpoint &&checkpoint);
+
+		/** @brief Test if the local part of the checkpoint is written.
+		*
+		*  @return true if the background writer of this process finished
+		*/
+		bool ready() const;
+
+		/** @brief Wait for the checkpoint.
+		*
+		*  Wait for the background writer and check the result on all processes.
+		*
+		*  @note collective
+		*  @return true if the file was written by all processes
+		*/
+		bool wait();
+};
+
 
 
 } /* end of petsc vector namespace */
 
 
 /* add implementations */
+#include "trace_impl.h"
+#include "pool_impl.h"
+#include "iscache_impl.h"
+#include "layout_impl.h"
 #include "petscvector_impl.h"
 #include "wrappercomb_impl.h"
 #include "wrappersub_impl.h"
 #include "wrappermul_impl.h"
+#include "wrapperdiv_impl.h"
+#include "reduction_impl.h"
+#include "multivector_impl.h"
+#include "blockdot_impl.h"
+#include "orthogonal_impl.h"
+#include "checkpoint_impl.h"
 
 #endif
@@ -4,106 +4,412 @@
 
 namespace petscvector {
 
+#ifdef PETSCVECTOR_OPENMP
+/* the type of vector is given by the options (-vec_type) as without threads; Petsc zeroes the array of standard CPU vector 
+ * in one thread, therefore it is replaced by the array allocated here without clearing, its pages are touched by 
+ * the threads which will work on them (the same static schedule of blocks as in the kernels), then they are placed 
+ * in the NUMA domains of these threads; the other types (f.x. GPU vectors) keep their own storage */
+void create_first_touch_petscvector(MPI_Comm comm, PetscInt local_size, PetscInt global_size, Vec *vec){
+	PetscScalar *arr;
+	PetscBool standard;
+	int i, k, block_end;
+
+	TRY( VecCreate(comm, vec) );
+	TRY( VecSetSizes(*vec, local_size, global_size) );
+	TRY( VecSetFromOptions(*vec) );
+
+	TRY( PetscObjectTypeCompareAny((PetscObject)*vec, &standard, VECSEQ, VECMPI, "") );
+	if(!standard){
+		return;
+	}
+
+	TRY( VecGetLocalSize(*vec, &local_size) );
+	TRY( PetscMalloc1(local_size, &arr) );
+	#pragma omp parallel for schedule(static) private(k, block_end) if(local_size >= PETSCVECTOR_OPENMP_MINSIZE)
+	for(i=0; i < local_size; i += PETSCVECTOR_BLOCKSIZE){
+		block_end = i + PETSCVECTOR_BLOCKSIZE;
+		if(block_end > local_size) block_end = local_size;
+		for(k=i; k < block_end; k++){
+			arr[k] = 0.0;
+		}
+	}
+	TRY( VecReplaceArray(*vec, arr) );
+}
+#endif
+
 PetscVector::PetscVector(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)CONSTRUCTOR: empty" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "empty");
 
 	inner_vector = NULL;
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = false;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
 }
 
 
-PetscVector::PetscVector(int n){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)CONSTRUCTOR: PetscVector(int)" << std::endl;
+PetscVector::PetscVector(int n, int local_size){
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(int,int)");
 
+#ifdef PETSCVECTOR_OPENMP
+	create_first_touch_petscvector(PETSC_COMM_WORLD, local_size, n, &inner_vector);
+#else
 	TRY( VecCreate(PETSC_COMM_WORLD,&inner_vector) );
-	TRY( VecSetSizes(inner_vector,PETSC_DECIDE,n) ); // TODO: there should be more options to set the distribution
+	TRY( VecSetSizes(inner_vector,local_size,n) );
+	TRY( VecSetFromOptions(inner_vector) );
+#endif
+
+	/* new vector does not contain any values to be assembled */
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = true;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
+}
+
+
+PetscVector::PetscVector(const PetscVectorLayout &layout){
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(layout)");
+
+#ifdef PETSCVECTOR_OPENMP
+	create_first_touch_petscvector(layout.get_comm(), layout.local_size(), layout.size(), &inner_vector);
+#else
+	TRY( VecCreate(layout.get_comm(),&inner_vector) );
+	TRY( VecSetSizes(inner_vector,layout.local_size(),layout.size()) );
 	TRY( VecSetFromOptions(inner_vector) );
+#endif
 
-	valuesUpdate();
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = true;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+
+	/* the layout is known, Petsc does not have to be asked */
+	layout_size = layout.size();
+	layout_local_size = layout.local_size();
+	layout.get_ownership(&layout_low, &layout_high);
 }
 
 
 PetscVector::PetscVector(double *values, int n){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)CONSTRUCTOR: PetscVector(values, int)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(values, int)");
 
 	TRY( VecCreateSeqWithArray(PETSC_COMM_SELF, 1, n, values, &inner_vector ) );
 	TRY( VecSetFromOptions(inner_vector) );
 
-	valuesUpdate();
+	/* new vector does not contain any values to be assembled */
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = false; /* the array belongs to the caller */
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
 }
 
 
 PetscVector::PetscVector(const PetscVector &vec){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)CONSTRUCTOR: PetscVector(&vec) ---- DUPLICATE ----" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(&vec) ---- DUPLICATE ----");
+
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = true;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
+
+	vec.valuesUpdate();
+
+	if(COPY_ON_WRITE_PETSCVECTOR && !vec.mapped_data && !vec.view){
+		/* share the inner vector, it will be duplicated before the first change 
+		 * (not the mapped one, the file is unmapped with the original vector, and not the column of multivector) */
+		TRACE_NOTE_PETSCVECTOR("share inner vector");
+		inner_vector = vec.inner_vector;
+		TRY( PetscObjectReference((PetscObject)inner_vector) );
+		shared = true;
+		vec.shared = true;
+		poolable = vec.poolable;
+		return;
+	}
 
 	/* there is duplicate... this function has to be called as less as possible */
-	TRY( VecDuplicate(vec.inner_vector, &inner_vector) );
+	POOL_PETSCVECTOR.checkout(vec.inner_vector, &inner_vector);
 	TRY( VecCopy(vec.inner_vector, inner_vector) );
 	
 }
 
 
+PetscVector::PetscVector(PetscVector &&vec){
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(&&vec) - move");
+
+	inner_vector = NULL;
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = false;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
+
+	/* the column stays in its multivector, only the values are copied */
+	if(vec.view){
+		vec.valuesUpdate();
+		POOL_PETSCVECTOR.checkout(vec.inner_vector, &inner_vector);
+		TRY( VecCopy(vec.inner_vector, inner_vector) );
+		poolable = true;
+		return;
+	}
+
+	/* take everything, the temporary vector stays empty */
+	this->swap(vec);
+}
+
+
 PetscVector::PetscVector(const Vec &new_inner_vector){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)CONSTRUCTOR: PetscVector(inner_vector)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(inner_vector)");
 
 	this->inner_vector = new_inner_vector;
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = false; /* the vector was created outside, it could be used in other Petsc objects */
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
 }
 
 
 PetscVector::PetscVector(const PetscVectorWrapperComb &comb){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)CONSTRUCTOR: PetscVector(comb)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(comb)");
 
 	inner_vector = NULL;
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = false;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
 	*this = comb; /* assemble the linear combination */
 
 }
 
 
+PetscVector::PetscVector(const PetscVectorWrapperDiv &div){
+	TRACE_PETSCVECTOR("PetscVector", "CONSTRUCTOR", "PetscVector(div)");
+
+	inner_vector = NULL;
+	values_dirty = false;
+	values_updating = false;
+	values_mode = NOT_SET_VALUES;
+	shared = false;
+	poolable = false;
+	mapped_data = NULL;
+	view = false;
+	mapped_size = 0;
+	layout_size = -1;
+	*this = div; /* compute the division */
+
+}
+
+
 PetscVector::~PetscVector(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)DESTRUCTOR" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "DESTRUCTOR", "");
+
+	destroy_inner_vector();
+}
 
+/* destroy inner vector (or return it to the pool) and unmap the file with values */
+void PetscVector::destroy_inner_vector(){
 	/* if there is any inner vector, then destroy it */
 	if(inner_vector){
-		if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - destroy inner vector" << std::endl;
+		TRACE_NOTE_PETSCVECTOR("destroy inner vector");
 
 		/* if petsc was finalized in the meantime, then the vector has been already destroyed */
 		if(PETSC_INITIALIZED){
+			/* the values which were not assembled yet are assembled by all processes (set() is called on all of them),
+			 * the stash is empty afterwards and the vector is destroyed or returned to the pool in the same way everywhere */
+			valuesUpdate();
+
 			/* if the vector wasn't destroyed yet and the petsc is still running, then
-			 * destroy the vector */
-			TRY( VecDestroy(&inner_vector) );
+			 * destroy the vector or return it to the pool */
+			if(poolable){
+				POOL_PETSCVECTOR.checkin(&inner_vector);
+			} else {
+				TRY( VecDestroy(&inner_vector) );
+			}
 		}
+		inner_vector = NULL;
+	}
+
+	/* the array of destroyed vector was mapped file */
+	if(mapped_data){
+		munmap(mapped_data, mapped_size);
+		mapped_data = NULL;
+		mapped_size = 0;
+	}
+
+	values_dirty = false;
+	values_updating = false;
+	shared = false;
+	layout_size = -1;
+}
+
+
+/* the values will be changed, get own copy of shared inner vector */
+void PetscVector::unshare() const{
+	if(!shared){
+		return;
+	}
+
+	PetscInt references;
+	TRY( PetscObjectGetReference((PetscObject)inner_vector, &references) );
+	
+	/* if the other copies were already destroyed or changed, the inner vector is not shared anymore */
+	if(references > 1){
+		TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "unshare() ---- DUPLICATE ----");
+
+		Vec new_inner_vector;
+		valuesUpdate();
+		POOL_PETSCVECTOR.checkout(inner_vector, &new_inner_vector);
+		TRY( VecCopy(inner_vector, new_inner_vector) );
+
+		/* release the reference to shared vector */
+		TRY( VecDestroy(&inner_vector) );
+		inner_vector = new_inner_vector;
+		poolable = true;
 	}
 
+	shared = false;
 }
 
 
+/* assemble the values set by set(int,double), only if there are any */
 void PetscVector::valuesUpdate() const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: valuesUpdate()" << std::endl;
+	valuesUpdateBegin();
+	valuesUpdateEnd();
+}
+
+
+void PetscVector::valuesUpdateBegin() const{
+	if(values_dirty && !values_updating){
+		TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "valuesUpdateBegin()");
+
+		TRY( VecAssemblyBegin(inner_vector) );
+		values_dirty = false;
+		values_updating = true;
+	}
+}
+
+
+void PetscVector::valuesUpdateEnd() const{
+	if(values_updating){
+		TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "valuesUpdateEnd()");
 
-	TRY( VecAssemblyBegin(inner_vector) );
-	TRY( VecAssemblyEnd(inner_vector) );
+		TRY( VecAssemblyEnd(inner_vector) );
+		values_updating = false;
+	}
 }
 
 
 void PetscVector::set(double new_value){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: set(double)" << std::endl;
-
-	TRY( VecSet(this->inner_vector,new_value) );
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "set(double)");
 
+	/* Petsc does not allow VecSet with values in the stash */
 	valuesUpdate();
+	unshare();
+
+	TRY( VecSet(this->inner_vector,new_value) );
 }
 
 
 void PetscVector::set(int index, double new_value){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: set(int,double)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "set(int,double)");
 
-	TRY( VecSetValue(this->inner_vector,index,new_value, INSERT_VALUES) );
-	
-	valuesUpdate();
+	set_values(1, &index, &new_value, INSERT_VALUES);
+}
+
+
+void PetscVector::set(int n, const int *indices, const double *new_values){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "set(int,int*,double*)");
+
+	set_values(n, indices, new_values, INSERT_VALUES);
+}
+
+
+void PetscVector::add(int n, const int *indices, const double *values){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "add(int,int*,double*)");
+
+	set_values(n, indices, values, ADD_VALUES);
+}
+
+
+void PetscVector::set_values(int n, const int *indices, const double *values, InsertMode mode){
+	unshare();
+
+	/* Petsc does not allow to mix insert modes without the assembly */
+	if(values_dirty && values_mode != mode){
+		TRACE_NOTE_PETSCVECTOR("change of insert mode");
+		valuesUpdate();
+	}
+
+	/* values could not be set during the assembly */
+	valuesUpdateEnd();
+
+	/* if the stash is empty, then prepare it for all values owned by other processes */
+	if(!values_dirty && n > 1){
+		int low, high, i;
+		int stash_size = 0;
+
+		get_ownership(&low, &high);
+		for(i=0; i < n; i++){
+			if(indices[i] < low || indices[i] >= high) stash_size++;
+		}
+
+		if(stash_size > 0){
+			TRY( VecStashSetInitialSize(inner_vector, stash_size, 0) );
+		}
+	}
+
+	TRY( VecSetValues(inner_vector, n, indices, values, mode) );
+
+	/* the assembly is postponed to the next operation with the vector */
+	values_dirty = true;
+	values_mode = mode;
 }
 
 void PetscVector::load_local(std::string filename){
 	if(!this->inner_vector){
 		TRY( VecCreate(PETSC_COMM_SELF,&inner_vector) );
+		poolable = true;
+	} else {
+		/* values in the stash would overwrite loaded values */
+		valuesUpdate();
+		unshare();
 	}
 
 	//TODO: check if file exists
@@ -118,13 +424,72 @@ void PetscVector::load_local(std::string filename){
 
 	/* destroy the viewer */
 	TRY( PetscViewerDestroy(&mviewer) );
+}
 
-	valuesUpdate();
+void PetscVector::load_local_mapped(std::string filename){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "load_local_mapped(string)");
+
+	int fd;
+	struct stat file_stat;
+	void *data;
+	PetscInt header[2]; /* class id and size */
+	PetscScalar *values;
+	bool swap = false;
+
+	fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_OPEN, PETSC_ERROR_INITIAL, "Cannot open file");
+		return;
+	}
+	if(fstat(fd, &file_stat) != 0 || (size_t)file_stat.st_size < sizeof(header)){
+		close(fd);
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_READ, PETSC_ERROR_INITIAL, "Cannot read header of file");
+		return;
+	}
+
+	/* private mapping, the changes of values are not written to the file */
+	data = mmap(NULL, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_READ, PETSC_ERROR_INITIAL, "Cannot map file");
+		return;
+	}
+
+	/* PETSc writes big-endian files, the values are swapped only if the class id is not in native byte order */
+	memcpy(header, data, sizeof(header));
+	if(header[0] != VEC_FILE_CLASSID){
+		TRY( PetscByteSwap(header, PETSC_INT, 2) );
+		swap = true;
+	}
+	if(header[0] != VEC_FILE_CLASSID || (size_t)file_stat.st_size < sizeof(header) + header[1]*sizeof(PetscScalar)){
+		munmap(data, file_stat.st_size);
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_UNEXPECTED, PETSC_ERROR_INITIAL, "File does not contain vector in PETSc binary format");
+		return;
+	}
+
+	values = (PetscScalar*)((char*)data + sizeof(header));
+	if(swap){
+		/* the pages are copied only now */
+		TRACE_NOTE_PETSCVECTOR("swap bytes of mapped values");
+		TRY( PetscByteSwap(values, PETSC_SCALAR, header[1]) );
+	}
+
+	/* replace the old vector by the vector with mapped array */
+	destroy_inner_vector();
+	TRY( VecCreateSeqWithArray(PETSC_COMM_SELF, 1, header[1], values, &inner_vector ) );
+	poolable = false;
+	mapped_data = data;
+	mapped_size = file_stat.st_size;
 }
 
 void PetscVector::load_global(std::string filename){
 	if(!this->inner_vector){
 		TRY( VecCreate(PETSC_COMM_WORLD,&inner_vector) );
+		poolable = true;
+	} else {
+		/* values in the stash would overwrite loaded values */
+		valuesUpdate();
+		unshare();
 	}
 
 	//TODO: check if file exists
@@ -139,13 +504,99 @@ void PetscVector::load_global(std::string filename){
 
 	/* destroy the viewer */
 	TRY( PetscViewerDestroy(&mviewer) );
+}
 
-	valuesUpdate();
+void PetscVector::load_parallel(std::string filename, int local_size){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "load_parallel(string,int)");
+
+	MPI_Comm comm;
+	MPI_File file;
+	MPI_Status status;
+	MPI_Offset offset;
+	MPI_Offset file_size;
+	PetscInt header[3]; /* class id, global size and the result of file size check */
+	PetscScalar *arr;
+	int rank, low, high, count;
+
+	if(!this->inner_vector){
+		comm = PETSC_COMM_WORLD;
+	} else {
+		/* values in the stash would overwrite loaded values */
+		valuesUpdate();
+		unshare();
+		TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	}
+	TRY( MPI_Comm_rank(comm, &rank) );
+
+	/* the file could not be used, MPI-IO returns the error (it does not abort) */
+	if(MPI_File_open(comm, (char*)filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS){
+		PetscError(comm, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_OPEN, PETSC_ERROR_INITIAL, "Cannot open file");
+		return;
+	}
+
+	/* the header is read only by the first process, the file is big-endian;
+	 * the size of file is checked there as well, otherwise the processes would read garbage behind the end of file */
+	if(rank == 0){
+		header[0] = 0;
+		header[1] = 0;
+		TRY( MPI_File_get_size(file, &file_size) );
+		TRY( MPI_File_read_at(file, 0, header, 2, MPIU_INT, &status) );
+#if !defined(PETSC_WORDS_BIGENDIAN)
+		TRY( PetscByteSwap(header, PETSC_INT, 2) );
+#endif
+		header[2] = (file_size >= (MPI_Offset)(2*sizeof(PetscInt)) + (MPI_Offset)header[1]*(MPI_Offset)sizeof(PetscScalar));
+	}
+	TRY( MPI_Bcast(header, 3, MPIU_INT, 0, comm) );
+
+	if(header[0] != VEC_FILE_CLASSID){
+		TRY( MPI_File_close(&file) );
+		PetscError(comm, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_UNEXPECTED, PETSC_ERROR_INITIAL, "File does not contain vector in PETSc binary format");
+		return;
+	}
+	if(!header[2]){
+		TRY( MPI_File_close(&file) );
+		PetscError(comm, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_UNEXPECTED, PETSC_ERROR_INITIAL, "File is shorter than the vector in its header");
+		return;
+	}
+
+	if(!this->inner_vector){
+		TRY( VecCreate(comm,&inner_vector) );
+		TRY( VecSetSizes(inner_vector,local_size,header[1]) );
+		TRY( VecSetFromOptions(inner_vector) );
+		poolable = true;
+	} else {
+		if(size() != header[1]){
+			TRY( MPI_File_close(&file) );
+			PetscError(comm, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Size of vector in file does not match the size of vector");
+			return;
+		}
+	}
+
+	/* every process reads its own part of values */
+	get_ownership(&low, &high);
+	offset = (MPI_Offset)(2*sizeof(PetscInt)) + (MPI_Offset)low*(MPI_Offset)sizeof(PetscScalar);
+
+	TRY( VecGetArray(inner_vector, &arr) );
+	TRY( MPI_File_read_at_all(file, offset, arr, high - low, MPIU_SCALAR, &status) );
+	TRY( MPI_Get_count(&status, MPIU_SCALAR, &count) );
+#if !defined(PETSC_WORDS_BIGENDIAN)
+	TRY( PetscByteSwap(arr, PETSC_SCALAR, high - low) );
+#endif
+	TRY( VecRestoreArray(inner_vector, &arr) );
+
+	TRY( MPI_File_close(&file) );
+
+	/* the file could be changed after the check of its size */
+	if(count != high - low){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_FILE_READ, PETSC_ERROR_INITIAL, "Cannot read all local values from file");
+	}
 }
 
 void PetscVector::save_binary(std::string filename){
 	//TODO: check if vector exists
 
+	valuesUpdate();
+
 	/* prepare viewer to save to file */
 	PetscViewer mviewer;
 	TRY( PetscViewerCreate(PETSC_COMM_WORLD, &mviewer) );
@@ -156,13 +607,48 @@ void PetscVector::save_binary(std::string filename){
 
 	/* destroy the viewer */
 	TRY( PetscViewerDestroy(&mviewer) );
+}
+
+void PetscVector::save_binary_native(std::string filename) const {
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "save_binary_native(string)");
+
+	MPI_Comm comm;
+	MPI_File file;
+	MPI_Status status;
+	MPI_Offset offset;
+	PetscInt header[2]; /* class id and global size */
+	const PetscScalar *arr;
+	int rank, low, high;
 
 	valuesUpdate();
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	get_ownership(&low, &high);
+	header[0] = VEC_FILE_CLASSID;
+	header[1] = size();
+
+	TRY( MPI_File_open(comm, (char*)filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) );
+	TRY( MPI_File_set_size(file, (MPI_Offset)(2*sizeof(PetscInt)) + (MPI_Offset)header[1]*(MPI_Offset)sizeof(PetscScalar)) );
+
+	/* the header is written by the first process, the values are not swapped */
+	if(rank == 0){
+		TRY( MPI_File_write_at(file, 0, header, 2, MPIU_INT, &status) );
+	}
+
+	offset = (MPI_Offset)(2*sizeof(PetscInt)) + (MPI_Offset)low*(MPI_Offset)sizeof(PetscScalar);
+	TRY( VecGetArrayRead(inner_vector, &arr) );
+	TRY( MPI_File_write_at_all(file, offset, (void*)arr, high - low, MPIU_SCALAR, &status) );
+	TRY( VecRestoreArrayRead(inner_vector, &arr) );
+
+	TRY( MPI_File_close(&file) );
 }
 
 void PetscVector::save_ascii(std::string filename){
 	//TODO: check if vector exists
 
+	valuesUpdate();
+
 	/* prepare viewer to save to file */
 	PetscViewer mviewer;
 	TRY( PetscViewerCreate(PETSC_COMM_WORLD, &mviewer) );
@@ -173,42 +659,280 @@ void PetscVector::save_ascii(std::string filename){
 
 	/* destroy the viewer */
 	TRY( PetscViewerDestroy(&mviewer) );
+}
+
+/* the components [begin[0],end[0]) and [begin[1],end[1]) of the part [low,high) are printed, 
+ * i.e. first head and last tail components of the vector (or all components if head < 0) */
+void print_range_petscvector(int low, int high, int size, int head, int tail, int *begin, int *end){
+	if(head < 0 || head + tail >= size){
+		begin[0] = low;
+		end[0] = high;
+		begin[1] = high;
+		end[1] = high;
+		return;
+	}
+
+	begin[0] = low;
+	end[0] = (high < head) ? high : head;
+	if(end[0] < begin[0]){
+		end[0] = begin[0];
+	}
+
+	begin[1] = (low > size - tail) ? low : size - tail;
+	end[1] = high;
+	if(end[1] < begin[1]){
+		end[1] = begin[1];
+	}
+}
+
+void PetscVector::save_ascii_parallel(std::string filename) const {
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "save_ascii_parallel(string)");
+
+	MPI_Comm comm;
+	MPI_File file;
+	MPI_Status status;
+	const PetscScalar *arr;
+	PetscInt local_size;
+	char text[PETSCVECTOR_PRINTCHUNK*32]; /* formatted chunk */
+	long long text_size, local_text_size, offset, total_size;
+	int i, j, k, chunk_end, rank;
+
+	valuesUpdate();
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( VecGetLocalSize(inner_vector, &local_size) );
+	TRY( VecGetArrayRead(inner_vector, &arr) );
+
+	/* the first sweep computes the length of local text, the second one writes it */
+	local_text_size = 0;
+	offset = 0;
+	for(k=0;k<2;k++){
+		if(k == 1){
+			/* the offset of local text in the file */
+			TRY( MPI_Exscan(&local_text_size, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm) );
+			if(rank == 0){
+				offset = 0;
+			}
+			TRY( MPI_Allreduce(&local_text_size, &total_size, 1, MPI_LONG_LONG, MPI_SUM, comm) );
+
+			TRY( MPI_File_open(comm, (char*)filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) );
+			TRY( MPI_File_set_size(file, total_size) );
+		}
+
+		for(i=0;i<local_size;i=chunk_end){
+			chunk_end = i + PETSCVECTOR_PRINTCHUNK;
+			if(chunk_end > local_size){
+				chunk_end = local_size;
+			}
+
+			/* format the chunk, the length of number is at most 24 characters with %.17g */
+			text_size = 0;
+			for(j=i;j<chunk_end;j++){
+				text_size += snprintf(text + text_size, 32, "%.17g\n", (double)arr[j]);
+			}
+
+			if(k == 0){
+				local_text_size += text_size;
+			} else {
+				TRY( MPI_File_write_at(file, offset, text, (int)text_size, MPI_CHAR, &status) );
+				offset += text_size;
+			}
+		}
+	}
+
+	TRY( MPI_File_close(&file) );
+	TRY( VecRestoreArrayRead(inner_vector, &arr) );
+}
+
+void PetscVector::print(std::ostream &output, int head, int tail) const {
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "print(ostream,int,int)");
+
+	MPI_Comm comm;
+	MPI_Status status;
+	const PetscScalar *arr;
+	const PetscScalar *values;
+	PetscScalar chunk[PETSCVECTOR_PRINTCHUNK];
+	const PetscInt *ranges;
+	PetscInt global_size;
+	int begin[2], end[2];
+	int rank, nproc, r, phase, i, j, count;
+	bool first = true;
 
 	valuesUpdate();
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( VecGetSize(inner_vector, &global_size) );
+	TRY( VecGetOwnershipRanges(inner_vector, &ranges) );
+	TRY( VecGetArrayRead(inner_vector, &arr) );
+
+	if(rank != 0){
+		/* send the printed components to the first process, head before tail */
+		print_range_petscvector(ranges[rank], ranges[rank+1], global_size, head, tail, begin, end);
+		for(phase=0;phase<2;phase++){
+			for(i=begin[phase];i<end[phase];i+=PETSCVECTOR_PRINTCHUNK){
+				count = (end[phase] - i < PETSCVECTOR_PRINTCHUNK) ? end[phase] - i : PETSCVECTOR_PRINTCHUNK;
+				TRY( MPI_Send((void*)(arr + i - ranges[rank]), count, MPIU_SCALAR, 0, 0, comm) );
+			}
+		}
+	} else {
+		output << "[";
+
+		/* the head of the vector from all processes, then the tail of the vector */
+		for(phase=0;phase<2;phase++){
+			for(r=0;r<nproc;r++){
+				print_range_petscvector(ranges[r], ranges[r+1], global_size, head, tail, begin, end);
+				for(i=begin[phase];i<end[phase];i+=PETSCVECTOR_PRINTCHUNK){
+					count = (end[phase] - i < PETSCVECTOR_PRINTCHUNK) ? end[phase] - i : PETSCVECTOR_PRINTCHUNK;
+					if(r == 0){
+						values = arr + i - ranges[0];
+					} else {
+						TRY( MPI_Recv(chunk, count, MPIU_SCALAR, r, 0, comm, &status) );
+						values = chunk;
+					}
+
+					for(j=0;j<count;j++){
+						if(!first) output << ", ";
+						output << values[j];
+						first = false;
+					}
+				}
+			}
+
+			/* skipped components */
+			if(phase == 0 && head >= 0 && head + tail < global_size){
+				if(!first) output << ", ";
+				output << "...";
+				first = false;
+			}
+		}
+
+		output << "]";
+	}
+
+	TRY( VecRestoreArrayRead(inner_vector, &arr) );
+}
+
+void PetscVector::print_summary(std::ostream &output, int samples) const {
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "print_summary(ostream,int)");
+
+	MPI_Comm comm;
+	PetscVectorReduction reduction;
+	double value_sum, value_norm, value_max, value_min;
+	const PetscScalar *arr;
+	PetscScalar *local_samples, *global_samples;
+	PetscInt global_size, low, high, index;
+	int rank, k;
+
+	/* sum, norm, maximum and minimum with one global reduction */
+	reduction.sum(*this, &value_sum);
+	reduction.norm(*this, &value_norm);
+	reduction.max(*this, &value_max);
+	reduction.min(*this, &value_min);
+	reduction.compute();
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( VecGetSize(inner_vector, &global_size) );
+	TRY( VecGetOwnershipRange(inner_vector, &low, &high) );
+
+	if(samples > global_size){
+		samples = global_size;
+	}
+
+	/* every sample is owned by one process, the others contribute by zero */
+	if(samples > 0){
+		TRY( PetscMalloc(2*samples*sizeof(PetscScalar), &local_samples) );
+		global_samples = local_samples + samples;
+
+		TRY( VecGetArrayRead(inner_vector, &arr) );
+		for(k=0;k<samples;k++){
+			index = (samples > 1) ? (PetscInt)(((long long)k*(global_size-1))/(samples-1)) : 0;
+			local_samples[k] = (index >= low && index < high) ? arr[index-low] : 0.0;
+		}
+		TRY( VecRestoreArrayRead(inner_vector, &arr) );
+
+		TRY( MPI_Reduce(local_samples, global_samples, samples, MPIU_SCALAR, MPIU_SUM, 0, comm) );
+	}
+
+	if(rank == 0){
+		output << "size: " << global_size << ", min: " << value_min << ", max: " << value_max;
+		output << ", sum: " << value_sum << ", norm: " << value_norm << std::endl;
+
+		output << "[";
+		for(k=0;k<samples;k++){
+			index = (samples > 1) ? (PetscInt)(((long long)k*(global_size-1))/(samples-1)) : 0;
+			output << index << ": " << global_samples[k];
+			if(k < samples-1) output << ", ";
+		}
+		output << "]";
+	}
+
+	if(samples > 0){
+		TRY( PetscFree(local_samples) );
+	}
 }
 
 Vec PetscVector::get_vector() const { // TODO: temp
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: get_vector()" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "get_vector()");
+
+	/* the vector will be used outside, therefore it has to be assembled and its values could be changed */
+	valuesUpdate();
+	unshare();
 		
 	return inner_vector;
 }
 
+/* the vector is only read by the library, it could stay shared */
+Vec PetscVector::get_vector_shared() const {
+	valuesUpdate();
+
+	return inner_vector;
+}
+
 
-int PetscVector::size() const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: size()" << std::endl;
+/* sizes of inner vector cannot change, they are read only once */
+void PetscVector::cache_layout() const{
+	if(layout_size >= 0){
+		return;
+	}
+
+	TRY( VecGetSize(inner_vector,&layout_size) );
+	TRY( VecGetLocalSize(inner_vector,&layout_local_size) );
+	TRY( VecGetOwnershipRange(inner_vector,&layout_low,&layout_high) );
+}
 
-	int global_size;
 
-	TRY( VecGetSize(inner_vector,&global_size) );
+int PetscVector::size() const{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "size()");
+
+	cache_layout();
 
-	return global_size;
+	return layout_size;
 }
 
 
 int PetscVector::local_size() const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: local_size()" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "local_size()");
+
+	cache_layout();
+
+	return layout_local_size;
+}
 
-	int local_size;
 
-	TRY( VecGetLocalSize(inner_vector,&local_size) );
+PetscVectorLayout PetscVector::get_layout() const{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "get_layout()");
 
-	return local_size;
+	return PetscVectorLayout(inner_vector);
 }
 
 
 double PetscVector::get(int i)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: get(int)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "get(int)");
 
 	PetscInt ni = 1;
 	PetscInt ix[1];
@@ -216,6 +940,7 @@ double PetscVector::get(int i)
 			
 	ix[0] = i;
 
+	valuesUpdate();
 	TRY( VecGetValues(inner_vector,ni,ix,y) );
 			
 	return y[0];
@@ -223,97 +948,152 @@ double PetscVector::get(int i)
 
 
 void PetscVector::get_array(double **arr){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: get_array(double **)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "get_array(double **)");
 
+	valuesUpdate();
+	unshare();
 	TRY( VecGetArray(inner_vector,arr) );
 }
 
 
 void PetscVector::restore_array(double **arr){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: restore_array(double **)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "restore_array(double **)");
 
 	TRY( VecRestoreArray(inner_vector,arr) );
 }
 
 
-void PetscVector::get_ownership(int *low, int *high){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: get_ownership(int*, int*)" << std::endl;
+void PetscVector::get_ownership(int *low, int *high) const{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "get_ownership(int*, int*)");
 
 	//TODO: control inner_vector
 
-	TRY( VecGetOwnershipRange(inner_vector, low, high) );
+	cache_layout();
+
+	if(low) *low = layout_low;
+	if(high) *high = layout_high;
 }
 
 
 void PetscVector::scale(double alpha){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: scale(double)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "scale(double)");
 
 	//TODO: control inner_vector
 
+	valuesUpdate();
+	unshare();
 	TRY( VecScale(inner_vector, alpha) );
-	valuesUpdate(); // TODO: has to be called?
 }
 
 
 std::ostream &operator<<(std::ostream &output, const PetscVector &vector)		
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: <<" << std::endl;
-
-	PetscScalar *arr_vector;
-	PetscInt i,local_size;
-	
-	// TODO: make more sofisticated for parallel vectors
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "<<");
 
-	output << "[";
-	TRY( VecGetLocalSize(vector.inner_vector,&local_size) );
-	TRY( VecGetArray(vector.inner_vector,&arr_vector) );
-	for (i=0; i<local_size; i++){
-		output << arr_vector[i];
-		if(i < local_size-1) output << ", ";
-	}
-	TRY( VecRestoreArray(vector.inner_vector,&arr_vector) );
-	output << "]";
+	/* collective, the components are written in global order by the first process */
+	vector.print(output);
 			
 	return output;
 }
 
 /* vec1 = vec2, assignment operator (set vector) */
 PetscVector &PetscVector::operator=(const PetscVector &vec2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: (vec = vec)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(vec = vec)");
 
 	/* check for self-assignment by comparing the address of the implicit object and the parameter */
 	/* vec1 = vec1 */
     if (this == &vec2){
-		if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - self assignment" << std::endl;		
+		TRACE_NOTE_PETSCVECTOR("self assignment");
         return *this;
 	}
 
+	vec2.valuesUpdate();
+
 	/* vec1 is not initialized yet */
 	if (!inner_vector){
-		if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - creating new vector" << std::endl;		
-		TRY( VecDuplicate(vec2.inner_vector,&(this->inner_vector)) );
-		this->valuesUpdate(); // TODO: has to be called?
+		if(COPY_ON_WRITE_PETSCVECTOR && !vec2.mapped_data && !vec2.view){
+			/* share the inner vector, it will be duplicated before the first change */
+			TRACE_NOTE_PETSCVECTOR("share inner vector");
+			inner_vector = vec2.inner_vector;
+			TRY( PetscObjectReference((PetscObject)inner_vector) );
+			shared = true;
+			vec2.shared = true;
+			poolable = vec2.poolable;
+			return *this;
+		}
+
+		TRACE_NOTE_PETSCVECTOR("creating new vector");
+		POOL_PETSCVECTOR.checkout(vec2.inner_vector,&(this->inner_vector));
+		poolable = true;
+	} else {
+		this->valuesUpdate();
+		this->unshare();
 	}
 
 	/* else copy the values of inner vectors */
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - copy values" << std::endl;		
+	TRACE_NOTE_PETSCVECTOR("copy values");
 	
 	TRY( VecCopy(vec2.inner_vector,inner_vector) );
-	this->valuesUpdate(); // TODO: has to be called?
 	
 	return *this;	
 }
 
+/* vec1 = temporary vec2, take the inner vector */
+PetscVector &PetscVector::operator=(PetscVector &&vec2){
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(vec = &&vec) - move");
+
+	/* columns of multivector are not exchanged, only the values are copied */
+	if(view || vec2.view){
+		return *this = (const PetscVector &)vec2;
+	}
+
+	if (this != &vec2){
+		/* old inner vector is moved to temporary vector and destroyed with it */
+		PetscVector old_vector(std::move(*this));
+		this->swap(vec2);
+	}
+
+	return *this;
+}
+
+/* exchange the inner vectors with their state, including the cached index sets */
+void PetscVector::swap(PetscVector &vec2){
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "swap(vec)");
+
+	std::swap(inner_vector, vec2.inner_vector);
+	std::swap(values_dirty, vec2.values_dirty);
+	std::swap(values_updating, vec2.values_updating);
+	std::swap(values_mode, vec2.values_mode);
+	std::swap(shared, vec2.shared);
+	std::swap(poolable, vec2.poolable);
+	std::swap(mapped_data, vec2.mapped_data);
+	std::swap(mapped_size, vec2.mapped_size);
+	std::swap(view, vec2.view);
+	std::swap(layout_size, vec2.layout_size);
+	std::swap(layout_local_size, vec2.layout_local_size);
+	std::swap(layout_low, vec2.layout_low);
+	std::swap(layout_high, vec2.layout_high);
+
+}
+
+void swap(PetscVector &vec1, PetscVector &vec2){
+	vec1.swap(vec2);
+}
+
 /* vec1 = linear_combination, perform full linear combination 
  * assemble linear combination and perform maxpy
  * */
-PetscVector &PetscVector::operator=(PetscVectorWrapperComb comb){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: (vec = comb)" << std::endl;
+PetscVector &PetscVector::operator=(const PetscVectorWrapperComb &comb){
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(vec = comb)");
 
 	/* vec1 is not initialized yet */
 	if (!inner_vector){
-		if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - duplicate vector" << std::endl;		
-		TRY( VecDuplicate(comb.get_first_vector(),&inner_vector) );
+		TRACE_NOTE_PETSCVECTOR("duplicate vector");
+		POOL_PETSCVECTOR.checkout(comb.get_first_vector(),&inner_vector);
+		poolable = true;
+	} else {
+		this->valuesUpdate();
+		this->unshare();
 	}
 
 	/* vec = comb */
@@ -324,7 +1104,7 @@ PetscVector &PetscVector::operator=(PetscVectorWrapperComb comb){
 
 /* vec1 = scalar_value <=> vec1(all) = scalar_value, assignment operator */
 PetscVector &PetscVector::operator=(double scalar_value){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: (vec = double)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(vec = double)");
 
 	this->set(scalar_value);
 	return *this;	
@@ -333,12 +1113,16 @@ PetscVector &PetscVector::operator=(double scalar_value){
 /* vec1 = mul(v1,v2), call vector-vector multiplication on mul 
  * */
 PetscVector &PetscVector::operator=(PetscVectorWrapperMul mulinstance){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: (vec = mul)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(vec = mul)");
 
 	/* vec1 is not initialized yet */
 	if (!inner_vector){
-		if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - duplicate vector" << std::endl;		
-		TRY( VecDuplicate(mulinstance.get_vector1(),&inner_vector) );
+		TRACE_NOTE_PETSCVECTOR("duplicate vector");
+		POOL_PETSCVECTOR.checkout(mulinstance.get_vector1(),&inner_vector);
+		poolable = true;
+	} else {
+		this->valuesUpdate();
+		this->unshare();
 	}
 
 	/* vec = mul */
@@ -347,55 +1131,79 @@ PetscVector &PetscVector::operator=(PetscVectorWrapperMul mulinstance){
 	return *this;	
 }
 
+/* the index sets are shared by all vectors on the same communicator */
+IS PetscVector::get_stride_is(int begin, int end, int stride) const
+{
+	MPI_Comm comm;
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	return ISCACHE_PETSCVECTOR.get_stride(comm, begin, end, stride);
+}
+
+/* vec1 = vec2/vec3, the division is written directly to vec1 */
+PetscVector &PetscVector::operator=(const PetscVectorWrapperDiv &divinstance){
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(vec = div)");
+
+	/* vec1 is not initialized yet */
+	if (!inner_vector){
+		TRACE_NOTE_PETSCVECTOR("duplicate vector");
+		POOL_PETSCVECTOR.checkout(divinstance.get_vector1(),&inner_vector);
+		poolable = true;
+	} else {
+		this->valuesUpdate();
+		this->unshare();
+	}
+
+	/* vec = div */
+	divinstance.div(inner_vector);
+
+	return *this;	
+}
+
 /* return subvector to be able to overload vector(index) = new_value */ 
 PetscVectorWrapperSub PetscVector::operator()(int index) const
 {   
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: (int) returns WrapperSub" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(int) returns WrapperSub");
 	
-	/* create new indexset */
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - create index set" << std::endl;
-	IS new_subvector_is;
-	PetscInt *idxs;
-	TRY(PetscMalloc(sizeof(PetscInt),&idxs));
+	/* index set with one component, the subvector destroys its reference */
+	IS new_subvector_is = get_stride_is(index, index, 1);
 	
-	idxs[0] = index;
-	
-	TRY( ISCreateGeneral(PETSC_COMM_WORLD, 1, idxs, PETSC_OWN_POINTER, &new_subvector_is));
-	// TODO: when to delete this index set?
-	
-	return PetscVectorWrapperSub(this->inner_vector, new_subvector_is, true);
+	/* the subvector unshares this vector only if its values are changed */
+	valuesUpdate();
+	return PetscVectorWrapperSub(this->inner_vector, new_subvector_is, true, this, true);
 }
 
 /* return subvector vector(index_begin:index_end), i.e. components with indexes: [index_begin, index_begin+1, ..., index_end] */ 
 PetscVectorWrapperSub PetscVector::operator()(int index_begin, int index_end) const
 {   
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: (int,int) returns WrapperSub" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "(int,int) returns WrapperSub");
 
-	/* create new indexset */
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - create index set" << std::endl;
-	IS new_subvector_is;
-	TRY( ISCreateStride(PETSC_COMM_WORLD, index_end-index_begin+1, index_begin,1, &new_subvector_is) );
-	// TODO: when to delete this index set?
+	/* index set from the cache, the subvector destroys its reference */
+	IS new_subvector_is = get_stride_is(index_begin, index_end, 1);
 		
-	return PetscVectorWrapperSub(this->inner_vector, new_subvector_is, true);
+	/* the subvector unshares this vector only if its values are changed */
+	valuesUpdate();
+	return PetscVectorWrapperSub(this->inner_vector, new_subvector_is, true, this, true);
 }
 
 /* return subvector based on provided index set */ 
 PetscVectorWrapperSub PetscVector::operator()(const IS new_subvector_is) const // TODO: are ju sure that this IS will be nt destroyed?
 {   
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec(IS)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec(IS)");
 	
-	return PetscVectorWrapperSub(inner_vector,new_subvector_is, false);
+	/* the subvector unshares this vector only if its values are changed */
+	valuesUpdate();
+	return PetscVectorWrapperSub(inner_vector,new_subvector_is, false, this);
 }
 
 /* define PetscVector(all) */
 PetscVectorWrapperSub PetscVector::operator()(petscvector_all_type all_type) const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec(all)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec(all)");
 
-	IS new_subvector_is; // TODO: this is quite stupid, what about returning *this?
-	ISCreateStride(PETSC_COMM_WORLD, this->size(), 0,1, &new_subvector_is);
-	
-	return PetscVectorWrapperSub(this->inner_vector, new_subvector_is, true);
+	/* alias of this vector, the operations are performed directly with inner vector */
+	/* the subvector unshares this vector only if its values are changed */
+	valuesUpdate();
+	return PetscVectorWrapperSub(this->inner_vector, this);
 } 
 
 
@@ -403,34 +1211,46 @@ PetscVectorWrapperSub PetscVector::operator()(petscvector_all_type all_type) con
 /* vec1 *= alpha */
 void operator*=(PetscVector &vec1, double alpha)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec *= double" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec *= double");
 	
 	vec1.scale(alpha);
 }
 
 /* vec1 += comb */
-void operator+=(const PetscVector &vec1, PetscVectorWrapperComb comb)
+void operator+=(PetscVector &vec1, const PetscVectorWrapperComb &comb)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec += comb" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec += comb");
 	
 	/* vec1.inner_vector should be allocated */
+	vec1.valuesUpdate();
+	vec1.unshare();
 	comb.compute(vec1.inner_vector,1.0);
 }
 
 /* vec1 -= comb */
-void operator-=(PetscVector &vec1, PetscVectorWrapperComb comb)
+void operator-=(PetscVector &vec1, const PetscVectorWrapperComb &comb)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec -= comb" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec -= comb");
 	
 	vec1 += (-1.0)*comb;
 }
 
+/* vec1 -= temporary comb, the combination is scaled in place */
+void operator-=(PetscVector &vec1, PetscVectorWrapperComb &&comb)
+{
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec -= comb");
+	
+	vec1 += (-1.0)*std::move(comb);
+}
+
 /* dot = dot(vec1,vec2) */
 double dot(const PetscVector &vec1, const PetscVector &vec2)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: dot(vec1,vec2)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "dot(vec1,vec2)");
 
 	double dot_value;
+	vec1.valuesUpdate();
+	vec2.valuesUpdate();
 	TRY( VecDot(vec1.inner_vector,vec2.inner_vector,&dot_value));
 	return dot_value;
 }
@@ -438,9 +1258,10 @@ double dot(const PetscVector &vec1, const PetscVector &vec2)
 /* norm = norm_2(vec1) */
 double norm(const PetscVector &vec1)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: norm(vec1)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "norm(vec1)");
 
 	double norm_value;
+	vec1.valuesUpdate();
 	TRY( VecNorm(vec1.inner_vector,NORM_2, &norm_value));
 	return norm_value;
 }
@@ -448,9 +1269,10 @@ double norm(const PetscVector &vec1)
 /* max = max(vec1) */
 double max(const PetscVector &vec1)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: max(vec)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "max(vec)");
 
 	double max_value;
+	vec1.valuesUpdate();
 	TRY( VecMax(vec1.inner_vector,NULL, &max_value) );
 	return max_value;
 }
@@ -458,29 +1280,66 @@ double max(const PetscVector &vec1)
 /* sum = sum(vec1) */
 double sum(const PetscVector &vec1)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: sum(vec)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "sum(vec)");
 
 	double sum_value;
+	vec1.valuesUpdate();
 	TRY( VecSum(vec1.inner_vector,&sum_value) );
 	return sum_value;
 }
 
-/* vec3 = vec1./vec2 */
-const PetscVector operator/(const PetscVector &vec1, const PetscVector &vec2)
+/* vec3 = vec1./vec2, the division is performed in the assignment */
+PetscVectorWrapperDiv operator/(const PetscVector &vec1, const PetscVector &vec2)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: vec1/vec2" << std::endl;
-
-	TRY(VecPointwiseDivide(vec1.inner_vector,vec1.inner_vector,vec2.inner_vector) );
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec1/vec2 returns WrapperDiv");
 
-	vec1.valuesUpdate(); // TODO: has to be called?
-	return vec1;
+	return PetscVectorWrapperDiv( vec1.get_vector_shared(), vec2.get_vector_shared());
 }
 
 PetscVectorWrapperMul mul(const PetscVector &vec1, const PetscVector &vec2)
 {
+	vec1.valuesUpdate();
+	vec2.valuesUpdate();
 	return PetscVectorWrapperMul( vec1.inner_vector, vec2.inner_vector);
 }
 
+/* abs(vec) is a combination with one elementwise node */
+PetscVectorWrapperComb abs(const PetscVector &vec1)
+{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "abs(vec) returns WrapperComb");
+
+	return PetscVectorWrapperComb(PetscVectorWrapperCombNode(1.0, COMB_NODE_ABS, vec1.get_vector_shared(), NULL));
+}
+
+/* sqrt(vec) = sqrt(abs(vec)) as in VecSqrtAbs */
+PetscVectorWrapperComb sqrt(const PetscVector &vec1)
+{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "sqrt(vec) returns WrapperComb");
+
+	return PetscVectorWrapperComb(PetscVectorWrapperCombNode(1.0, COMB_NODE_SQRT, vec1.get_vector_shared(), NULL));
+}
+
+PetscVectorWrapperComb exp(const PetscVector &vec1)
+{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "exp(vec) returns WrapperComb");
+
+	return PetscVectorWrapperComb(PetscVectorWrapperCombNode(1.0, COMB_NODE_EXP, vec1.get_vector_shared(), NULL));
+}
+
+PetscVectorWrapperComb min(const PetscVector &vec1, const PetscVector &vec2)
+{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "min(vec,vec) returns WrapperComb");
+
+	return PetscVectorWrapperComb(PetscVectorWrapperCombNode(1.0, COMB_NODE_MIN, vec1.get_vector_shared(), vec2.get_vector_shared()));
+}
+
+PetscVectorWrapperComb max(const PetscVector &vec1, const PetscVector &vec2)
+{
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "max(vec,vec) returns WrapperComb");
+
+	return PetscVectorWrapperComb(PetscVectorWrapperCombNode(1.0, COMB_NODE_MAX, vec1.get_vector_shared(), vec2.get_vector_shared()));
+}
+
 
 
 } /* end of petscvector namespace */
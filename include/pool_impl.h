@@ -0,0 +1,169 @@
+#ifndef PETSCVECTOR_POOL_IMPL_H
+#define	PETSCVECTOR_POOL_IMPL_H
+
+namespace petscvector {
+
+/* called from PetscFinalize, the stored vectors have to be destroyed while Petsc is running */
+PetscErrorCode pool_finalize_petscvector(){
+	POOL_PETSCVECTOR.clear();
+	return 0;
+}
+
+/* constructor of empty pool, it is global object, therefore it cannot call Petsc functions */
+PetscVectorPool::PetscVectorPool(){
+	items_size = 0;
+	hits = 0;
+	misses = 0;
+	drops = 0;
+	registered = false;
+}
+
+/* store the layout of the vector into the item */
+void PetscVectorPool::get_layout(Vec vec, PetscVectorPoolItem *item){
+	TRY( VecGetSize(vec, &(item->size)) );
+	TRY( VecGetLocalSize(vec, &(item->local_size)) );
+	TRY( VecGetBlockSize(vec, &(item->block_size)) );
+	TRY( PetscObjectGetComm((PetscObject)vec, &(item->comm)) );
+	TRY( VecGetType(vec, &(item->type)) );
+}
+
+/* compare ownership ranges of all processes, they are known on every process */
+bool PetscVectorPool::same_ranges(Vec vec1, Vec vec2, MPI_Comm comm){
+	const PetscInt *ranges1, *ranges2;
+	int nproc, r;
+
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( VecGetOwnershipRanges(vec1, &ranges1) );
+	TRY( VecGetOwnershipRanges(vec2, &ranges2) );
+
+	for(r=0;r<=nproc;r++){
+		if(ranges1[r] != ranges2[r]){
+			return false;
+		}
+	}
+	return true;
+}
+
+/* find the vector with the same layout, the most recently returned first;
+ * the vectors on one communicator are stored and taken in the same order on all its processes (see checkin), 
+ * the layout is compared using the ownership ranges of all processes, therefore all processes find the same vector */
+void PetscVectorPool::checkout(Vec layout, Vec *vec){
+	TRACE_PETSCVECTOR("VectorPool", "FUNCTION", "checkout(Vec,Vec*)");
+
+	PetscVectorPoolItem wanted;
+	PetscBool same_type;
+	int i;
+
+	if(POOL_MODE_PETSCVECTOR && items_size > 0){
+		get_layout(layout, &wanted);
+
+		for(i=items_size-1;i>=0;i--){
+			if(items[i].size == wanted.size && items[i].local_size == wanted.local_size && items[i].block_size == wanted.block_size && items[i].comm == wanted.comm
+				&& same_ranges(items[i].vec, layout, wanted.comm)){
+				TRY( PetscObjectTypeCompare((PetscObject)(items[i].vec), wanted.type, &same_type) );
+				if(same_type){
+					TRACE_NOTE_PETSCVECTOR("vector found in pool");
+					*vec = items[i].vec;
+
+					/* keep the order of remaining vectors */
+					for(;i<items_size-1;i++){
+						items[i] = items[i+1];
+					}
+					items_size -= 1;
+					hits += 1;
+					return;
+				}
+			}
+		}
+	}
+
+	TRACE_NOTE_PETSCVECTOR("duplicate vector ---- DUPLICATE ----");
+	TRY( VecDuplicate(layout, vec) );
+	misses += 1;
+}
+
+/* store the vector, destroy it if it is not possible; 
+ * the decision is made by all processes of the vector together, otherwise the pools would differ */
+void PetscVectorPool::checkin(Vec *vec){
+	TRACE_PETSCVECTOR("VectorPool", "FUNCTION", "checkin(Vec*)");
+
+	PetscInt references;
+	MPI_Comm comm;
+	int nproc;
+	int unused, storable;
+
+	if(POOL_MODE_PETSCVECTOR){
+		/* shared vector is still used by somebody else */
+		TRY( PetscObjectGetReference((PetscObject)(*vec), &references) );
+		TRY( PetscObjectGetComm((PetscObject)(*vec), &comm) );
+		TRY( MPI_Comm_size(comm, &nproc) );
+
+		unused = (references == 1);
+		storable = (unused && items_size < PETSCVECTOR_POOLSIZE);
+		if(nproc > 1){
+			TRY( MPI_Allreduce(MPI_IN_PLACE, &storable, 1, MPI_INT, MPI_LAND, comm) );
+		}
+
+		if(storable){
+			/* stored vectors are destroyed in PetscFinalize */
+			if(!registered){
+				TRY( PetscRegisterFinalize(&pool_finalize_petscvector) );
+				registered = true;
+			}
+
+			TRACE_NOTE_PETSCVECTOR("store vector in pool");
+			get_layout(*vec, &(items[items_size]));
+			items[items_size].vec = *vec;
+			items_size += 1;
+			*vec = NULL;
+			return;
+		}
+
+		if(unused){
+			drops += 1;
+		}
+	}
+
+	TRY( VecDestroy(vec) );
+}
+
+/* destroy all stored vectors */
+void PetscVectorPool::clear(){
+	TRACE_PETSCVECTOR("VectorPool", "FUNCTION", "clear()");
+
+	int i;
+	for(i=0;i<items_size;i++){
+		TRY( VecDestroy(&(items[i].vec)) );
+	}
+	items_size = 0;
+
+	/* PetscFinalize forgets registered functions, Petsc could be initialized again */
+	registered = false;
+}
+
+int PetscVectorPool::get_size() const {
+	return items_size;
+}
+
+int PetscVectorPool::get_hits() const {
+	return hits;
+}
+
+int PetscVectorPool::get_misses() const {
+	return misses;
+}
+
+int PetscVectorPool::get_drops() const {
+	return drops;
+}
+
+void PetscVectorPool::reset_stats(){
+	hits = 0;
+	misses = 0;
+	drops = 0;
+}
+
+
+} /* end of petscvector namespace */
+
+#endif
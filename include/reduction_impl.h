@@ -0,0 +1,716 @@
+#ifndef PETSCVECTOR_REDUCTION_IMPL_H
+#define	PETSCVECTOR_REDUCTION_IMPL_H
+
+
+namespace petscvector {
+
+/* operation on pairs (value, type of reduction), the type decides between sum and max (minimum is the maximum of -x_i) */
+void reduction_op_petscvector(void *invec, void *inoutvec, int *len, MPI_Datatype *datatype){
+	double *in = (double *)invec;
+	double *inout = (double *)inoutvec;
+	int j;
+
+	for(j=0; j < *len; j++){
+		if((int)in[2*j+1] == REDUCTION_MAX || (int)in[2*j+1] == REDUCTION_MIN){
+			if(in[2*j] > inout[2*j]) inout[2*j] = in[2*j];
+		} else {
+			inout[2*j] += in[2*j];
+		}
+	}
+}
+
+/* free MPI datatype and operation, called from PetscFinalize */
+PetscErrorCode reduction_finalize_petscvector(){
+	if(REDUCTION_OP_PETSCVECTOR != MPI_OP_NULL){
+		MPI_Op_free(&REDUCTION_OP_PETSCVECTOR);
+	}
+	if(REDUCTION_TYPE_PETSCVECTOR != MPI_DATATYPE_NULL){
+		MPI_Type_free(&REDUCTION_TYPE_PETSCVECTOR);
+	}
+	return 0;
+}
+
+
+/* constructor of empty batch */
+PetscVectorReduction::PetscVectorReduction(){
+	TRACE_PETSCVECTOR("Reduction", "CONSTRUCTOR", "empty");
+
+	allocated_items = NULL;
+	items_size = 0;
+	items_capacity = PETSCVECTOR_REDUCTIONSIZE;
+	comm = MPI_COMM_NULL;
+
+	buffer = buffer_inline;
+	request = MPI_REQUEST_NULL;
+	computing = false;
+}
+
+/* destructor */
+PetscVectorReduction::~PetscVectorReduction(){
+	TRACE_PETSCVECTOR("Reduction", "DESTRUCTOR", "");
+
+	/* the reduction in progress has to be finished before the buffer is freed, the results are not stored */
+	if(computing){
+		TRY( MPI_Wait(&request, MPI_STATUS_IGNORE) );
+		if(buffer != buffer_inline){
+			TRY( PetscFree(buffer) );
+		}
+	}
+
+	/* release the operands of reductions which were not computed (if Petsc was not finalized in the meantime) */
+	if(PETSC_INITIALIZED){
+		PetscVectorReductionItem *items = get_items();
+		int j;
+		for(j=0; j < items_size; j++){
+			if(items[j].x){
+				TRY( VecDestroy(&(items[j].x)) );
+			}
+			if(items[j].y){
+				TRY( VecDestroy(&(items[j].y)) );
+			}
+		}
+	}
+
+	if(allocated_items){
+		delete [] allocated_items;
+	}
+}
+
+PetscVectorReductionItem *PetscVectorReduction::get_items(){
+	return allocated_items ? allocated_items : inline_items;
+}
+
+int PetscVectorReduction::get_size() const{
+	return items_size;
+}
+
+/* prepare space for new reductions */
+void PetscVectorReduction::reserve(int new_capacity){
+	if(new_capacity <= items_capacity){
+		return;
+	}
+
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "reserve(int) - allocate items");
+
+	/* at least double the capacity to append items in amortized constant time */
+	if(new_capacity < 2*items_capacity){
+		new_capacity = 2*items_capacity;
+	}
+
+	PetscVectorReductionItem *old_items = get_items();
+	PetscVectorReductionItem *new_items = new PetscVectorReductionItem[new_capacity];
+	int j;
+	for(j=0;j<items_size;j++){
+		new_items[j] = old_items[j];
+	}
+
+	if(allocated_items){
+		delete [] allocated_items;
+	}
+	allocated_items = new_items;
+	items_capacity = new_capacity;
+}
+
+/* local value of reduction on [begin,end) */
+void PetscVectorReduction::reduce_local(PetscVectorReductionType type, const double *x, const double *y, int begin, int end, double *value){
+	int i;
+	double local_value = *value;
+
+	switch(type){
+		case REDUCTION_DOT:
+			for(i=begin; i < end; i++) local_value += x[i]*y[i];
+			break;
+		case REDUCTION_NORM:
+			for(i=begin; i < end; i++) local_value += x[i]*x[i];
+			break;
+		case REDUCTION_SUM:
+			for(i=begin; i < end; i++) local_value += x[i];
+			break;
+		case REDUCTION_MAX:
+			for(i=begin; i < end; i++){
+				if(x[i] > local_value) local_value = x[i];
+			}
+			break;
+		case REDUCTION_MIN:
+			for(i=begin; i < end; i++){
+				if(-x[i] > local_value) local_value = -x[i];
+			}
+			break;
+	}
+
+	*value = local_value;
+}
+
+/* add new reduction, the local value of subvectors is computed now */
+void PetscVectorReduction::append(PetscVectorReductionType type, Vec x, Vec y, bool now, double *result){
+	if(computing){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Reduction could not be added before compute_end()");
+	}
+
+	/* the global reduction will be performed in the communicator of operands */
+	MPI_Comm x_comm;
+	int same_comm;
+	TRY( PetscObjectGetComm((PetscObject)x, &x_comm) );
+	if(comm == MPI_COMM_NULL){
+		comm = x_comm;
+	} else if(x_comm != comm){
+		TRY( MPI_Comm_compare(x_comm, comm, &same_comm) );
+		if(same_comm != MPI_IDENT && same_comm != MPI_CONGRUENT){
+			PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_NOTSAMECOMM, PETSC_ERROR_INITIAL, "Operands of reductions in one batch have to be of the same communicator");
+			return;
+		}
+	}
+
+	reserve(items_size+1);
+
+	PetscVectorReductionItem *item = &(get_items()[items_size]);
+	item->type = type;
+	item->x = x;
+	item->y = y;
+	item->value = (type == REDUCTION_MAX || type == REDUCTION_MIN) ? -PETSC_MAX_REAL : 0.0;
+	item->result = result;
+
+	items_size++;
+
+	if(now){
+		TRACE_NOTE_PETSCVECTOR("compute local value of subvector");
+
+		int x_size, y_size;
+		const double *x_arr;
+		const double *y_arr = NULL;
+
+		TRY( VecGetLocalSize(x, &x_size) );
+		TRY( VecGetArrayRead(x, &x_arr) );
+		if(y){
+			TRY( VecGetLocalSize(y, &y_size) );
+			if(x_size != y_size){
+				PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+			}
+			TRY( VecGetArrayRead(y, &y_arr) );
+		}
+
+		reduce_local(type, x_arr, y_arr, 0, x_size, &(item->value));
+
+		if(y){
+			TRY( VecRestoreArrayRead(y, &y_arr) );
+		}
+		TRY( VecRestoreArrayRead(x, &x_arr) );
+
+		item->x = NULL;
+		item->y = NULL;
+	} else {
+		/* the operands could be temporaries, they are kept until compute_local() */
+		TRY( PetscObjectReference((PetscObject)x) );
+		TRY( PetscObjectStateGet((PetscObject)x, &(item->x_state)) );
+		if(y){
+			TRY( PetscObjectReference((PetscObject)y) );
+			TRY( PetscObjectStateGet((PetscObject)y, &(item->y_state)) );
+		}
+	}
+}
+
+/* compute local values of all deferred reductions in one sweep */
+void PetscVectorReduction::compute_local(){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "compute_local()");
+
+	PetscVectorReductionItem *items = get_items();
+	int j, k;
+
+	/* the arrays of distinct operands and the operands of items, stored on stack for short batches */
+	Vec vectors_inline[2*PETSCVECTOR_REDUCTIONSIZE];
+	const double *arrays_inline[2*PETSCVECTOR_REDUCTIONSIZE];
+	int x_index_inline[PETSCVECTOR_REDUCTIONSIZE];
+	int y_index_inline[PETSCVECTOR_REDUCTIONSIZE];
+
+	Vec *vectors = vectors_inline;
+	const double **arrays = arrays_inline;
+	int *x_index = x_index_inline;
+	int *y_index = y_index_inline;
+
+	if(items_size > PETSCVECTOR_REDUCTIONSIZE){
+		TRY( PetscMalloc(2*items_size*sizeof(Vec), &vectors) );
+		TRY( PetscMalloc(2*items_size*sizeof(const double *), &arrays) );
+		TRY( PetscMalloc(items_size*sizeof(int), &x_index) );
+		TRY( PetscMalloc(items_size*sizeof(int), &y_index) );
+	}
+
+	/* find distinct operands, each of them will be read only once */
+	int vectors_size = 0;
+	PetscObjectState state;
+	for(j=0; j < items_size; j++){
+		x_index[j] = -1;
+		y_index[j] = -1;
+		if(!items[j].x){
+			continue;
+		}
+
+		/* the values of operands were changed after append(), the result would not be the one which was asked for */
+		TRY( PetscObjectStateGet((PetscObject)items[j].x, &state) );
+		if(state != items[j].x_state){
+			PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Operand of reduction was changed before compute()");
+		}
+		if(items[j].y){
+			TRY( PetscObjectStateGet((PetscObject)items[j].y, &state) );
+			if(state != items[j].y_state){
+				PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Operand of reduction was changed before compute()");
+			}
+		}
+
+		for(k=0; k < vectors_size && vectors[k] != items[j].x; k++);
+		if(k == vectors_size) vectors[vectors_size++] = items[j].x;
+		x_index[j] = k;
+
+		if(items[j].y){
+			for(k=0; k < vectors_size && vectors[k] != items[j].y; k++);
+			if(k == vectors_size) vectors[vectors_size++] = items[j].y;
+			y_index[j] = k;
+		}
+	}
+
+	if(vectors_size > 0){
+		int local_size, other_size, begin, end;
+		PetscLogDouble flops = 0.0;
+
+		TRY( VecGetLocalSize(vectors[0], &local_size) );
+		for(k=0; k < vectors_size; k++){
+			TRY( VecGetLocalSize(vectors[k], &other_size) );
+			if(other_size != local_size){
+				PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_SIZ, PETSC_ERROR_INITIAL, "Incompatible vector local lengths");
+			}
+			TRY( VecGetArrayRead(vectors[k], &(arrays[k])) );
+		}
+
+		/* go through blocks, the block of every operand stays in cache for all reductions */
+#ifdef PETSCVECTOR_OPENMP
+		/* every thread reduces its blocks into its own values, they are added to the items afterwards */
+		int threads = omp_get_max_threads();
+		int t;
+		double *thread_values;
+		TRY( PetscMalloc1((size_t)threads*items_size, &thread_values) );
+		for(t=0; t < threads; t++){
+			for(j=0; j < items_size; j++){
+				thread_values[t*items_size+j] = (items[j].type == REDUCTION_MAX || items[j].type == REDUCTION_MIN) ? -PETSC_MAX_REAL : 0.0;
+			}
+		}
+
+		#pragma omp parallel for schedule(static) private(j, end) if(local_size >= PETSCVECTOR_OPENMP_MINSIZE)
+		for(begin=0; begin < local_size; begin += PETSCVECTOR_BLOCKSIZE){
+			double *values = thread_values + omp_get_thread_num()*items_size;
+			end = begin + PETSCVECTOR_BLOCKSIZE;
+			if(end > local_size) end = local_size;
+
+			for(j=0; j < items_size; j++){
+				if(x_index[j] >= 0){
+					reduce_local(items[j].type, arrays[x_index[j]], (y_index[j] >= 0) ? arrays[y_index[j]] : NULL, begin, end, &(values[j]));
+				}
+			}
+		}
+
+		for(t=0; t < threads; t++){
+			for(j=0; j < items_size; j++){
+				if(x_index[j] < 0){
+					continue;
+				}
+				if(items[j].type == REDUCTION_MAX || items[j].type == REDUCTION_MIN){
+					if(thread_values[t*items_size+j] > items[j].value) items[j].value = thread_values[t*items_size+j];
+				} else {
+					items[j].value += thread_values[t*items_size+j];
+				}
+			}
+		}
+		TRY( PetscFree(thread_values) );
+#else
+		for(begin=0; begin < local_size; begin += PETSCVECTOR_BLOCKSIZE){
+			end = begin + PETSCVECTOR_BLOCKSIZE;
+			if(end > local_size) end = local_size;
+
+			for(j=0; j < items_size; j++){
+				if(x_index[j] >= 0){
+					reduce_local(items[j].type, arrays[x_index[j]], (y_index[j] >= 0) ? arrays[y_index[j]] : NULL, begin, end, &(items[j].value));
+				}
+			}
+		}
+#endif
+
+		for(k=0; k < vectors_size; k++){
+			TRY( VecRestoreArrayRead(vectors[k], &(arrays[k])) );
+		}
+
+		for(j=0; j < items_size; j++){
+			if(x_index[j] >= 0){
+				flops += (items[j].type == REDUCTION_DOT || items[j].type == REDUCTION_NORM) ? 2.0*local_size : local_size;
+
+				/* release the operands, the temporaries are destroyed (or returned to the pool) now */
+				TRY( VecDestroy(&(items[j].x)) );
+				if(items[j].y){
+					TRY( VecDestroy(&(items[j].y)) );
+				}
+			}
+		}
+		TRY( PetscLogFlops(flops) );
+	}
+
+	if(items_size > PETSCVECTOR_REDUCTIONSIZE){
+		TRY( PetscFree(vectors) );
+		TRY( PetscFree(arrays) );
+		TRY( PetscFree(x_index) );
+		TRY( PetscFree(y_index) );
+	}
+}
+
+/* compute local values and perform one global reduction */
+void PetscVectorReduction::compute(){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "compute()");
+
+	compute_begin();
+	compute_end();
+}
+
+/* compute local values and start the global reduction */
+void PetscVectorReduction::compute_begin(){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "compute_begin()");
+
+	if(items_size == 0 || computing){
+		return;
+	}
+
+	compute_local();
+
+	/* prepare pair datatype and operation, they are freed in PetscFinalize */
+	if(REDUCTION_OP_PETSCVECTOR == MPI_OP_NULL){
+		TRY( MPI_Type_contiguous(2, MPI_DOUBLE, &REDUCTION_TYPE_PETSCVECTOR) );
+		TRY( MPI_Type_commit(&REDUCTION_TYPE_PETSCVECTOR) );
+		TRY( MPI_Op_create(&reduction_op_petscvector, 1, &REDUCTION_OP_PETSCVECTOR) );
+		TRY( PetscRegisterFinalize(&reduction_finalize_petscvector) );
+	}
+
+	PetscVectorReductionItem *items = get_items();
+	int j;
+
+	if(items_size > PETSCVECTOR_REDUCTIONSIZE){
+		TRY( PetscMalloc(2*items_size*sizeof(double), &buffer) );
+	}
+
+	for(j=0; j < items_size; j++){
+		buffer[2*j] = items[j].value;
+		buffer[2*j+1] = (double)items[j].type;
+	}
+
+	/* all reductions at once, the buffer stays allocated until the end */
+#if MPI_VERSION >= 3
+	TRY( MPI_Iallreduce(MPI_IN_PLACE, buffer, items_size, REDUCTION_TYPE_PETSCVECTOR, REDUCTION_OP_PETSCVECTOR, comm, &request) );
+#else
+	TRY( MPI_Allreduce(MPI_IN_PLACE, buffer, items_size, REDUCTION_TYPE_PETSCVECTOR, REDUCTION_OP_PETSCVECTOR, comm) );
+	request = MPI_REQUEST_NULL;
+#endif
+
+	computing = true;
+}
+
+/* wait for the global reduction and store the results */
+void PetscVectorReduction::compute_end(){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "compute_end()");
+
+	if(!computing){
+		return;
+	}
+
+	TRY( MPI_Wait(&request, MPI_STATUS_IGNORE) );
+	finish();
+}
+
+/* if the global reduction is finished, then store the results */
+bool PetscVectorReduction::compute_test(){
+	int finished;
+
+	if(!computing){
+		return true;
+	}
+
+	TRY( MPI_Test(&request, &finished, MPI_STATUS_IGNORE) );
+	if(finished){
+		finish();
+	}
+
+	return (bool)finished;
+}
+
+void PetscVectorReduction::finish(){
+	PetscVectorReductionItem *items = get_items();
+	int j;
+
+	for(j=0; j < items_size; j++){
+		if(items[j].type == REDUCTION_NORM){
+			*(items[j].result) = std::sqrt(buffer[2*j]);
+		} else if(items[j].type == REDUCTION_MIN){
+			*(items[j].result) = -buffer[2*j];
+		} else {
+			*(items[j].result) = buffer[2*j];
+		}
+		TRACE_VALUE_PETSCVECTOR("reduction result", *(items[j].result));
+	}
+
+	if(buffer != buffer_inline){
+		TRY( PetscFree(buffer) );
+		buffer = buffer_inline;
+	}
+
+	/* the batch could be used again */
+	items_size = 0;
+	comm = MPI_COMM_NULL;
+	computing = false;
+}
+
+void PetscVectorReduction::dot(const PetscVector &x, const PetscVector &y, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "dot(vec,vec)");
+
+	append(REDUCTION_DOT, x.get_vector_shared(), y.get_vector_shared(), false, result);
+}
+
+void PetscVectorReduction::dot(const PetscVector &x, const PetscVectorWrapperSub &y, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "dot(vec,subvec)");
+
+	append(REDUCTION_DOT, x.get_vector_shared(), y.subvector, true, result);
+}
+
+void PetscVectorReduction::dot(const PetscVectorWrapperSub &x, const PetscVector &y, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "dot(subvec,vec)");
+
+	append(REDUCTION_DOT, x.subvector, y.get_vector_shared(), true, result);
+}
+
+void PetscVectorReduction::dot(const PetscVectorWrapperSub &x, const PetscVectorWrapperSub &y, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "dot(subvec,subvec)");
+
+	append(REDUCTION_DOT, x.subvector, y.subvector, true, result);
+}
+
+void PetscVectorReduction::norm(const PetscVector &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "norm(vec)");
+
+	append(REDUCTION_NORM, x.get_vector_shared(), NULL, false, result);
+}
+
+void PetscVectorReduction::norm(const PetscVectorWrapperSub &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "norm(subvec)");
+
+	append(REDUCTION_NORM, x.subvector, NULL, true, result);
+}
+
+void PetscVectorReduction::sum(const PetscVector &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "sum(vec)");
+
+	append(REDUCTION_SUM, x.get_vector_shared(), NULL, false, result);
+}
+
+void PetscVectorReduction::sum(const PetscVectorWrapperSub &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "sum(subvec)");
+
+	append(REDUCTION_SUM, x.subvector, NULL, true, result);
+}
+
+void PetscVectorReduction::max(const PetscVector &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "max(vec)");
+
+	append(REDUCTION_MAX, x.get_vector_shared(), NULL, false, result);
+}
+
+void PetscVectorReduction::max(const PetscVectorWrapperSub &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "max(subvec)");
+
+	append(REDUCTION_MAX, x.subvector, NULL, true, result);
+}
+
+void PetscVectorReduction::min(const PetscVector &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "min(vec)");
+
+	append(REDUCTION_MIN, x.get_vector_shared(), NULL, false, result);
+}
+
+void PetscVectorReduction::min(const PetscVectorWrapperSub &x, double *result){
+	TRACE_PETSCVECTOR("Reduction", "FUNCTION", "min(subvec)");
+
+	append(REDUCTION_MIN, x.subvector, NULL, true, result);
+}
+
+
+
+/* PetscVectorFuture constructor, the state is allocated to keep the address of result during the reduction */
+PetscVectorFuture::PetscVectorFuture(){
+	TRACE_PETSCVECTOR("Future", "CONSTRUCTOR", "empty");
+
+	state = new PetscVectorFutureState;
+	state->value = 0.0;
+}
+
+/* move constructor, take the state */
+PetscVectorFuture::PetscVectorFuture(PetscVectorFuture &&future){
+	TRACE_PETSCVECTOR("Future", "CONSTRUCTOR", "move");
+
+	state = future.state;
+	future.state = NULL;
+}
+
+/* destructor, the reduction batch waits for the reduction in progress */
+PetscVectorFuture::~PetscVectorFuture(){
+	TRACE_PETSCVECTOR("Future", "DESTRUCTOR", "");
+
+	if(state){
+		delete state;
+	}
+}
+
+/* move assignment */
+PetscVectorFuture &PetscVectorFuture::operator=(PetscVectorFuture &&future){
+	TRACE_PETSCVECTOR("Future", "OPERATOR", "(future = future) move");
+
+	if(this != &future){
+		if(state){
+			delete state;
+		}
+		state = future.state;
+		future.state = NULL;
+	}
+
+	return *this;
+}
+
+/* the moved-from future has no state, the empty one is given to return valid reference */
+PetscVectorReduction &PetscVectorFuture::get_reduction(){
+	if(!state){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Future was moved from");
+		state = new PetscVectorFutureState;
+		state->value = 0.0;
+	}
+
+	return state->reduction;
+}
+
+double *PetscVectorFuture::get_result(){
+	if(!state){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Future was moved from");
+		state = new PetscVectorFutureState;
+		state->value = 0.0;
+	}
+
+	return &(state->value);
+}
+
+bool PetscVectorFuture::ready(){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "ready()");
+
+	if(!state){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Future was moved from");
+		return false;
+	}
+
+	return state->reduction.compute_test();
+}
+
+double PetscVectorFuture::get(){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "get()");
+
+	if(!state){
+		PetscError(PETSC_COMM_SELF, __LINE__, PETSC_FUNCTION_NAME, __FILE__, PETSC_ERR_ARG_WRONGSTATE, PETSC_ERROR_INITIAL, "Future was moved from");
+		return 0.0;
+	}
+
+	state->reduction.compute_end();
+
+	return state->value;
+}
+
+PetscVectorFuture dot_async(const PetscVector &x, const PetscVector &y){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "dot_async(vec,vec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().dot(x, y, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture dot_async(const PetscVector &x, const PetscVectorWrapperSub &y){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "dot_async(vec,subvec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().dot(x, y, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture dot_async(const PetscVectorWrapperSub &x, const PetscVector &y){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "dot_async(subvec,vec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().dot(x, y, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture dot_async(const PetscVectorWrapperSub &x, const PetscVectorWrapperSub &y){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "dot_async(subvec,subvec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().dot(x, y, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture norm_async(const PetscVector &x){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "norm_async(vec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().norm(x, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture norm_async(const PetscVectorWrapperSub &x){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "norm_async(subvec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().norm(x, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture sum_async(const PetscVector &x){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "sum_async(vec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().sum(x, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture sum_async(const PetscVectorWrapperSub &x){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "sum_async(subvec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().sum(x, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture max_async(const PetscVector &x){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "max_async(vec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().max(x, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+PetscVectorFuture max_async(const PetscVectorWrapperSub &x){
+	TRACE_PETSCVECTOR("Future", "FUNCTION", "max_async(subvec)");
+
+	PetscVectorFuture future;
+	future.get_reduction().max(x, future.get_result());
+	future.get_reduction().compute_begin();
+	return future;
+}
+
+
+} /* end of petscvector namespace */
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PETSCVECTOR_TRACE_IMPL_H
+#define	PETSCVECTOR_TRACE_IMPL_H
+
+#ifdef PETSCVECTOR_TRACE
+
+namespace petscvector {
+
+/* write one trace record to TRACE_STREAM_PETSCVECTOR */
+void trace_record(int level, const char *owner, const char *kind, const char *name, double value, const char *file, int line){
+	static int trace_id = 0; /* sequence number of the record */
+
+	if(DEBUG_MODE_PETSCVECTOR < level){
+		return;
+	}
+
+	std::ostream &output = *TRACE_STREAM_PETSCVECTOR;
+
+	if(TRACE_FORMAT_PETSCVECTOR == 0){
+		/* human readable message */
+		if(strcmp(kind,"NOTE") == 0){
+			output << " - " << name << std::endl;
+		} else if(strcmp(kind,"VALUE") == 0){
+			output << " - " << name << ": " << value << std::endl;
+		} else {
+			output << "(" << owner << ")" << kind;
+			if(name[0] != '\0'){
+				output << ": " << name;
+			}
+			output << std::endl;
+		}
+	} else {
+		/* structured record, one per line */
+		int rank = 0;
+		int mpi_initialized;
+		MPI_Initialized(&mpi_initialized);
+		if(mpi_initialized){
+			MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+		}
+
+		output << "petscvector_trace;id=" << trace_id << ";rank=" << rank << ";time=" << MPI_Wtime();
+		output << ";class=" << owner << ";kind=" << kind << ";name=" << name << ";value=" << value;
+		output << ";file=" << file << ";line=" << line << std::endl;
+	}
+
+	trace_id++;
+}
+
+} /* end of petscvector namespace */
+
+#endif
+
+#endif
@@ -5,17 +5,27 @@ namespace petscvector {
 
 /* --------------------- PetscVectorWrapperComb ----------------------*/
 
+/* constructor of empty combination */
+PetscVectorWrapperComb::PetscVectorWrapperComb(){
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "empty");
+
+	allocated_nodes = NULL;
+	nodes_size = 0;
+	nodes_capacity = PETSCVECTOR_COMBSIZE;
+	vector_size = 0;
+}
+
 /* constructor from node */
-PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVectorWrapperCombNode &comb_node){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)CONSTRUCTOR: WrapperComb" << std::endl;
+PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVectorWrapperCombNode &comb_node) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "WrapperComb");
 
 	/* append node */
 	this->append(comb_node);
 }
 
 /* constructor from vec */
-PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVector &vec){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)CONSTRUCTOR: from given PetscVector" << std::endl;
+PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVector &vec) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "from given PetscVector");
 
 	/* create node from vector */
 	PetscVectorWrapperCombNode comb_node(vec);
@@ -25,8 +35,8 @@ PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVector &vec){
 }
 
 /* constructor from subvector */
-PetscVectorWrapperComb::PetscVectorWrapperComb(PetscVectorWrapperSub subvector){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)CONSTRUCTOR: WrapperSub" << std::endl;
+PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVectorWrapperSub &subvector) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "WrapperSub");
 
 	/* create node from vector */
 	PetscVectorWrapperCombNode comb_node(1.0,subvector.get_subvector());
@@ -36,122 +46,574 @@ PetscVectorWrapperComb::PetscVectorWrapperComb(PetscVectorWrapperSub subvector){
 
 }
 
+/* constructor from mul(x,y), the product is one elementwise node */
+PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVectorWrapperMul &mulinstance) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "WrapperMul");
+
+	this->append(PetscVectorWrapperCombNode(1.0, COMB_NODE_MUL, mulinstance.get_vector1(), mulinstance.get_vector2()));
+}
+
+/* constructor from x/y, the quotient is one elementwise node */
+PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVectorWrapperDiv &div) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "WrapperDiv");
+
+	this->append(PetscVectorWrapperCombNode(1.0, COMB_NODE_DIV, div.get_vector1(), div.get_vector2()));
+}
+
+/* copy constructor */
+PetscVectorWrapperComb::PetscVectorWrapperComb(const PetscVectorWrapperComb &comb) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "copy");
+
+	this->merge(comb);
+	this->vector_size = comb.vector_size;
+}
+
+/* move constructor */
+PetscVectorWrapperComb::PetscVectorWrapperComb(PetscVectorWrapperComb &&comb) : PetscVectorWrapperComb() {
+	TRACE_PETSCVECTOR("WrapperComb", "CONSTRUCTOR", "move");
+
+	*this = std::move(comb);
+}
+
 /* destructor */
 PetscVectorWrapperComb::~PetscVectorWrapperComb(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)DESTRUCTOR" << std::endl;
+	TRACE_PETSCVECTOR("WrapperComb", "DESTRUCTOR", "");
+
+	/* inline nodes are destroyed with the object */
+	if(allocated_nodes){
+		delete [] allocated_nodes;
+	}
+}
+
+/* comb1 = comb2 */
+PetscVectorWrapperComb &PetscVectorWrapperComb::operator=(const PetscVectorWrapperComb &comb){
+	TRACE_PETSCVECTOR("WrapperComb", "OPERATOR", "(comb = comb)");
 
-	// TODO: destroy list
+	if(this != &comb){
+		/* keep the storage, only forget the nodes */
+		nodes_size = 0;
+		this->merge(comb);
+		this->vector_size = comb.vector_size;
+	}
 
+	return *this;
 }
 
-/* append new node to the list */
+/* comb1 = temporary comb2 */
+PetscVectorWrapperComb &PetscVectorWrapperComb::operator=(PetscVectorWrapperComb &&comb){
+	TRACE_PETSCVECTOR("WrapperComb", "OPERATOR", "(comb = move comb)");
+
+	if(this != &comb){
+		if(comb.allocated_nodes){
+			/* take the allocated storage */
+			if(allocated_nodes){
+				delete [] allocated_nodes;
+			}
+			allocated_nodes = comb.allocated_nodes;
+			nodes_size = comb.nodes_size;
+			nodes_capacity = comb.nodes_capacity;
+
+			comb.allocated_nodes = NULL;
+			comb.nodes_capacity = PETSCVECTOR_COMBSIZE;
+		} else {
+			/* nodes are inline, they have to be copied */
+			nodes_size = 0;
+			this->merge(comb);
+		}
+		this->vector_size = comb.vector_size;
+
+		comb.nodes_size = 0;
+	}
+
+	return *this;
+}
+
+/* get the storage with nodes */
+PetscVectorWrapperCombNode *PetscVectorWrapperComb::get_nodes(){
+	return allocated_nodes ? allocated_nodes : inline_nodes;
+}
+
+const PetscVectorWrapperCombNode *PetscVectorWrapperComb::get_nodes() const {
+	return allocated_nodes ? allocated_nodes : inline_nodes;
+}
+
+/* make sure that the storage is large enough */
+void PetscVectorWrapperComb::reserve(int new_capacity){
+	if(new_capacity <= nodes_capacity){
+		return;
+	}
+
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "reserve(int) - allocate nodes");
+
+	/* at least double the capacity to append nodes in amortized constant time */
+	if(new_capacity < 2*nodes_capacity){
+		new_capacity = 2*nodes_capacity;
+	}
+
+	PetscVectorWrapperCombNode *old_nodes = get_nodes();
+	PetscVectorWrapperCombNode *new_nodes = new PetscVectorWrapperCombNode[new_capacity];
+	int j;
+	for(j=0;j<nodes_size;j++){
+		new_nodes[j] = old_nodes[j];
+	}
+
+	if(allocated_nodes){
+		delete [] allocated_nodes;
+	}
+	allocated_nodes = new_nodes;
+	nodes_capacity = new_capacity;
+}
+
+/* append new node to the end of combination */
 void PetscVectorWrapperComb::append(const PetscVectorWrapperCombNode &new_node){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)FUNCTION: append(WrapperCombNode)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "append(WrapperCombNode)");
 	
-	comb_list.push_back(new_node);
+	reserve(nodes_size+1);
+	get_nodes()[nodes_size] = new_node;
+	nodes_size += 1;
 	
-	/* store the size of the new node */
-	this->vector_size = new_node.get_size();
+	/* the size of vectors is read when it is needed (scalar node does not have any vector) */
+	if(new_node.get_vector() && this->vector_size == 0){
+		this->vector_size = -1;
+	}
 }
 
-/* append new list to the end of old list (merge without sort), will be called from overloaded operator+ */
+/* append nodes of given combination to the end (merge without sort), will be called from overloaded operator+ */
 void PetscVectorWrapperComb::merge(const PetscVectorWrapperComb &comb){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)FUNCTION: merge(WrapperComb)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "merge(WrapperComb)");
+
+	/* the combination could be merged with itself, remember the size before reallocation */
+	int comb_size = comb.nodes_size;
+	reserve(nodes_size + comb_size);
+
+	const PetscVectorWrapperCombNode *comb_nodes = comb.get_nodes();
+	PetscVectorWrapperCombNode *nodes = get_nodes();
+	int j;
+	for(j=0;j<comb_size;j++){
+		nodes[nodes_size+j] = comb_nodes[j];
+	}
+	nodes_size += comb_size;
+
+	/* maybe this combination was empty or it was only a scalar */
+	if(vector_size == 0){
+		vector_size = comb.vector_size;
+	}
+}
+
+/* scale all nodes */
+void PetscVectorWrapperComb::scale(double alpha){
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "scale(double)");
 
-	comb_list.insert(comb_list.end(), comb.comb_list.begin(), comb.comb_list.end());
+	PetscVectorWrapperCombNode *nodes = get_nodes();
+	int j;
+	for(j=0;j<nodes_size;j++){
+		nodes[j].scale(alpha);
+	}
 }
 
-/* get length of the list */
+/* get number of nodes */
 int PetscVectorWrapperComb::get_listsize() const {
-	return comb_list.size();
+	return nodes_size;
 }
 
-/* get size of the vectors in the list */
+/* get size of the vectors in the combination */
 int PetscVectorWrapperComb::get_vectorsize() const {
+	if(vector_size < 0){
+		TRY( VecGetSize(get_first_vector(), &vector_size) );
+	}
 	return vector_size;
 }
 
-/* get frist vector from the list */
-Vec PetscVectorWrapperComb::get_first_vector() {
-	std::list<PetscVectorWrapperCombNode>::iterator list_iter; /* iterator through list */
-	Vec vector;
-
-	/* get first element and obtain a size of the vector */
-	list_iter = comb_list.begin();
-	vector = list_iter->get_vector();
-
-	return vector;
+/* get frist vector from the combination, scalar nodes do not have any */
+Vec PetscVectorWrapperComb::get_first_vector() const {
+	const PetscVectorWrapperCombNode *nodes = get_nodes();
+	int j;
+	for(j=0;j<nodes_size;j++){
+		if(nodes[j].get_vector()){
+			return nodes[j].get_vector();
+		}
+	}
+	return NULL;
 }
 
 /* perform scale, maxpy and addscalar and store it into given Vec (allocated) */
-void PetscVectorWrapperComb::compute(const Vec &y, double init_scale){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)FUNCTION: process(Vec,double)" << std::endl;
+void PetscVectorWrapperComb::compute(const Vec &y, double init_scale) const {
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "process(Vec,double)");
 
 	int list_size = get_listsize();
-	PetscScalar *alphas;
-	Vec *vectors;
+	PetscScalar alphas_inline[PETSCVECTOR_COMBSIZE];
+	Vec vectors_inline[PETSCVECTOR_COMBSIZE];
+	const PetscVectorWrapperCombNode *elementwise_inline[PETSCVECTOR_COMBSIZE];
+	PetscScalar *alphas = alphas_inline;
+	Vec *vectors = vectors_inline;
+	const PetscVectorWrapperCombNode **elementwise = elementwise_inline;
+	Vec copies_inline[PETSCVECTOR_COMBSIZE];
+	Vec *copies = copies_inline;
 	double scale = init_scale; /* = 0.0 if y=comb, = 1.0 if y+=comb */
 	double shift = 0.0;
 	int maxpy_length = 0;
+	int elementwise_length = 0;
 
-	/* go throught the list:
+	/* go throught the nodes:
+	 * - if elementwise operation (mul, div, abs, ...) => prepare to the array of elementwise nodes
 	 * - if same vector => scale += coeff
 	 * - if scalar (NULL Vec) => shift += coeff
 	 * - otherwise prepare to array to maxpy
 	 * 
 	 * afterwards
+	 * y = scale*y + shift + alphas*vectors + coeffs*op(x,z) (compute_fused, one sweep through arrays)
+	 * 
+	 * or if it is not possible
+	 * t_j = op(x_j,z_j) (temporary vectors)
 	 * y = scale*y (VecScale)
 	 * y = y + shift (VecShift)
 	 * y += alphas*vectors (VecMAXPY)
+	 * y += coeffs*t (VecMAXPY)
 	 */ 
 
-	/* allocate memory */
-	TRY(PetscMalloc(sizeof(PetscScalar)*list_size,&alphas));
-	TRY(PetscMalloc(sizeof(Vec)*list_size,&vectors));
+	/* allocate memory only for long combinations */
+	if(list_size > PETSCVECTOR_COMBSIZE){
+		TRY(PetscMalloc(sizeof(PetscScalar)*list_size,&alphas));
+		TRY(PetscMalloc(sizeof(Vec)*list_size,&vectors));
+		TRY(PetscMalloc(sizeof(const PetscVectorWrapperCombNode*)*list_size,&elementwise));
+		TRY(PetscMalloc(sizeof(Vec)*list_size,&copies));
+	}
 
 	/* get array with coefficients and vectors */
-	std::list<PetscVectorWrapperCombNode>::iterator list_iter; /* iterator through list */
+	const PetscVectorWrapperCombNode *nodes = get_nodes();
 	int j;
 
-	/* set iterator to the begin of the list */
-	list_iter = comb_list.begin();
-
-	/* go through the list and fill the vectors */
+	/* go through the nodes and fill the vectors */
 	for(j=0;j<list_size;j++){
-		/* if Vec==NULL, then add to the shift */
-		if(list_iter->get_vector() == NULL){
-			shift += list_iter->get_coeff();
+		if(nodes[j].get_type() != COMB_NODE_VECTOR){
+			/* elementwise operation, it is evaluated separately */
+			elementwise[elementwise_length] = &(nodes[j]);
+			elementwise_length += 1;
+		} else if(nodes[j].get_vector() == NULL){
+			/* if Vec==NULL, then add to the shift */
+			shift += nodes[j].get_coeff();
 		} else {
 			/* if same vector => scale += coeff */
-			if(list_iter->get_vector() == y){
-				scale+=list_iter->get_coeff();
+			if(nodes[j].get_vector() == y){
+				scale+=nodes[j].get_coeff();
 			} else {
 				/* otherwise prepare to maxpy-arrays */
-				alphas[maxpy_length] = list_iter->get_coeff();
-				vectors[maxpy_length] = list_iter->get_vector();
+				alphas[maxpy_length] = nodes[j].get_coeff();
+				vectors[maxpy_length] = nodes[j].get_vector();
 
 				maxpy_length += 1;
 			} 
 		}
-		
-		if(j < list_size-1){
-			/* this is not the last element */
-			list_iter++;
+	}
+
+	/* the subvectors of the same original vector could be views to the same array (see PetscVectorWrapperSub),
+	 * the view of the same slice is the same vector, the overlapping one is copied before y is changed,
+	 * the decision depends only on the slices, therefore all processes create the same copies */
+	bool overlap = false;
+	int copies_length = 0;
+	if(PetscVectorWrapperSub::is_view(y)){
+		for(j=0;j<maxpy_length;){
+			switch(PetscVectorWrapperSub::compare_views(vectors[j], y)){
+				case 1:
+					scale += alphas[j];
+					alphas[j] = alphas[maxpy_length-1];
+					vectors[j] = vectors[maxpy_length-1];
+					maxpy_length -= 1;
+					continue;
+				case 2:
+					TRACE_NOTE_PETSCVECTOR("copy overlapping view");
+					POOL_PETSCVECTOR.checkout(vectors[j], &(copies[copies_length]));
+					TRY( VecCopy(vectors[j], copies[copies_length]) );
+					vectors[j] = copies[copies_length];
+					copies_length += 1;
+					break;
+				default:
+					break;
+			}
+			j++;
+		}
+
+		/* Petsc functions evaluate the elementwise nodes into temporary vectors before y is changed */
+		for(j=0;j<elementwise_length;j++){
+			if(PetscVectorWrapperSub::compare_views(elementwise[j]->get_vector(), y) == 2 || PetscVectorWrapperSub::compare_views(elementwise[j]->get_vector2(), y) == 2){
+				overlap = true;
+			}
 		}
 	}
 
 	/* print info about performed stuff */
-	if(DEBUG_MODE_PETSCVECTOR >= 99){
-		std::cout << " - linear combination:" << std::endl;
-		std::cout << "  - scale: " << scale << std::endl;
-		std::cout << "  - shift: " << shift << std::endl;
-		std::cout << "  - maxpy: " << maxpy_length << std::endl;
+	TRACE_VALUE_PETSCVECTOR("linear combination scale", scale);
+	TRACE_VALUE_PETSCVECTOR("linear combination shift", shift);
+	TRACE_VALUE_PETSCVECTOR("linear combination maxpy", maxpy_length);
+	TRACE_VALUE_PETSCVECTOR("linear combination elementwise", elementwise_length);
+
+	/* try to go through the local arrays only once, otherwise use Petsc functions */
+	if(!FUSED_MODE_PETSCVECTOR || overlap || !compute_fused(y, scale, shift, maxpy_length, alphas, vectors, elementwise_length, elementwise)){
+		compute_petsc(y, scale, shift, maxpy_length, alphas, vectors, elementwise_length, elementwise);
 	}
 
-	/* there will be maxy y+=..., it is necessary to change scale coeff */
-//	if(maxpy_length > 0){
-//		scale += -1.0;
-//	}
+	for(j=0;j<copies_length;j++){
+		POOL_PETSCVECTOR.checkin(&(copies[j]));
+	}
+
+	/* free memory */
+	if(list_size > PETSCVECTOR_COMBSIZE){
+		TRY(PetscFree(alphas));
+		TRY(PetscFree(vectors));
+		TRY(PetscFree(elementwise));
+		TRY(PetscFree(copies));
+	}
+
+}
+
+
+/* y = scale*y + shift + sum(alphas*vectors) + sum(coeffs*op(x,z)) in one sweep through local arrays, return false if not possible */
+bool PetscVectorWrapperComb::compute_fused(Vec y, double scale, double shift, int maxpy_length, const PetscScalar *alphas, const Vec *vectors, int elementwise_length, const PetscVectorWrapperCombNode * const *elementwise) const {
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "compute_fused(Vec,double,double,int,double*,Vec*,int,WrapperCombNode**)");
+
+	int local_size, vector_local_size;
+	int i, j, k, block_end;
+	PetscScalar *y_arr;
+	const PetscScalar *arrays_inline[PETSCVECTOR_COMBSIZE];
+	const PetscScalar **arrays = arrays_inline;
+	const PetscScalar *elementwise_arrays_inline[2*PETSCVECTOR_COMBSIZE];
+	const PetscScalar **elementwise_arrays = elementwise_arrays_inline;
+	PetscScalar block[PETSCVECTOR_BLOCKSIZE]; /* values of elementwise nodes in actual block */
+	PetscScalar alpha;
+	const PetscScalar *x_arr;
+	const PetscScalar *z_arr;
+	Vec operand;
+	bool overlap = false;
+
+	/* all vectors have to be of the same local size, otherwise let Petsc throw an error */
+	TRY( VecGetLocalSize(y,&local_size) );
+	for(j=0;j<maxpy_length;j++){
+		TRY( VecGetLocalSize(vectors[j],&vector_local_size) );
+		if(vector_local_size != local_size){
+			TRACE_NOTE_PETSCVECTOR("local sizes do not match, use Petsc functions");
+			return false;
+		}
+	}
+	for(j=0;j<2*elementwise_length;j++){
+		operand = (j%2 == 0) ? elementwise[j/2]->get_vector() : elementwise[j/2]->get_vector2();
+		if(operand){
+			TRY( VecGetLocalSize(operand,&vector_local_size) );
+			if(vector_local_size != local_size){
+				TRACE_NOTE_PETSCVECTOR("local sizes do not match, use Petsc functions");
+				return false;
+			}
+		}
+	}
+
+	/* get arrays of all vectors */
+	if(maxpy_length > PETSCVECTOR_COMBSIZE){
+		TRY( PetscMalloc(sizeof(const PetscScalar*)*maxpy_length,&arrays) );
+	}
+	if(elementwise_length > PETSCVECTOR_COMBSIZE){
+		TRY( PetscMalloc(sizeof(const PetscScalar*)*2*elementwise_length,&elementwise_arrays) );
+	}
+	TRY( VecGetArray(y,&y_arr) );
+	for(j=0;j<maxpy_length;j++){
+		TRY( VecGetArrayRead(vectors[j],&(arrays[j])) );
+
+		/* the same array as result (i.e. subvector which is a view) is the same vector, it is added to the scale,
+		 * but shifted arrays (i.e. overlapping subvectors) would be overwritten before they are read */
+		if(arrays[j] == y_arr){
+			scale += alphas[j];
+		} else if(arrays[j] < y_arr + local_size && y_arr < arrays[j] + local_size){
+			overlap = true;
+		}
+	}
+	for(j=0;j<2*elementwise_length;j++){
+		operand = (j%2 == 0) ? elementwise[j/2]->get_vector() : elementwise[j/2]->get_vector2();
+		elementwise_arrays[j] = NULL;
+		if(operand){
+			TRY( VecGetArrayRead(operand,&(elementwise_arrays[j])) );
+
+			/* the same, the block of result is written after all elementwise nodes are evaluated */
+			if(elementwise_arrays[j] != y_arr && elementwise_arrays[j] < y_arr + local_size && y_arr < elementwise_arrays[j] + local_size){
+				overlap = true;
+			}
+		}
+	}
+
+	if(!overlap){
+		/* go through the vector block after block, the block of the result stays in cache,
+		 * the blocks are independent, they could be distributed to threads */
+#ifdef PETSCVECTOR_OPENMP
+		#pragma omp parallel for schedule(static) private(j, k, block_end, block, alpha, x_arr, z_arr) if(local_size >= PETSCVECTOR_OPENMP_MINSIZE)
+#endif
+		for(i=0;i<local_size;i+=PETSCVECTOR_BLOCKSIZE){
+			block_end = i + PETSCVECTOR_BLOCKSIZE;
+			if(block_end > local_size){
+				block_end = local_size;
+			}
+
+			/* block = sum(coeff_j*op_j(x_j,z_j)), evaluated before y is changed (y could be an operand) */
+			if(elementwise_length > 0){
+				for(k=i;k<block_end;k++){
+					block[k-i] = 0.0;
+				}
+			}
+			for(j=0;j<elementwise_length;j++){
+				alpha = elementwise[j]->get_coeff();
+				x_arr = elementwise_arrays[2*j];
+				z_arr = elementwise_arrays[2*j+1];
+				switch(elementwise[j]->get_type()){
+					case COMB_NODE_MUL:
+						for(k=i;k<block_end;k++){
+							block[k-i] += alpha*x_arr[k]*z_arr[k];
+						}
+						break;
+					case COMB_NODE_DIV:
+						for(k=i;k<block_end;k++){
+							/* as VecPointwiseDivide, zero divisor gives zero */
+							if(z_arr[k] != 0.0){
+								block[k-i] += alpha*x_arr[k]/z_arr[k];
+							}
+						}
+						break;
+					case COMB_NODE_ABS:
+						for(k=i;k<block_end;k++){
+							block[k-i] += alpha*std::fabs(x_arr[k]);
+						}
+						break;
+					case COMB_NODE_SQRT:
+						for(k=i;k<block_end;k++){
+							block[k-i] += alpha*std::sqrt(std::fabs(x_arr[k]));
+						}
+						break;
+					case COMB_NODE_EXP:
+						for(k=i;k<block_end;k++){
+							block[k-i] += alpha*std::exp(x_arr[k]);
+						}
+						break;
+					case COMB_NODE_MIN:
+						for(k=i;k<block_end;k++){
+							block[k-i] += alpha*(x_arr[k] < z_arr[k] ? x_arr[k] : z_arr[k]);
+						}
+						break;
+					case COMB_NODE_MAX:
+						for(k=i;k<block_end;k++){
+							block[k-i] += alpha*(x_arr[k] > z_arr[k] ? x_arr[k] : z_arr[k]);
+						}
+						break;
+					default:
+						break;
+				}
+			}
+
+			/* y = scale*y + shift, do not read y if scale = 0 (it could be uninitialized) */
+			if(scale == 0.0){
+				for(k=i;k<block_end;k++){
+					y_arr[k] = shift;
+				}
+			} else {
+				if(scale != 1.0 || shift != 0.0){
+					for(k=i;k<block_end;k++){
+						y_arr[k] = scale*y_arr[k] + shift;
+					}
+				}
+			}
+
+			/* y += alpha_j*x_j */
+			for(j=0;j<maxpy_length;j++){
+				alpha = alphas[j];
+				x_arr = arrays[j];
+				if(x_arr == y_arr){
+					continue;
+				}
+				for(k=i;k<block_end;k++){
+					y_arr[k] += alpha*x_arr[k];
+				}
+			}
+
+			/* y += block */
+			if(elementwise_length > 0){
+				for(k=i;k<block_end;k++){
+					y_arr[k] += block[k-i];
+				}
+			}
+		}
+
+		TRY( PetscLogFlops(local_size*(2.0*maxpy_length + 3.0*elementwise_length + (scale != 1.0) + (shift != 0.0))) );
+	} else {
+		TRACE_NOTE_PETSCVECTOR("arrays overlap, use Petsc functions");
+	}
+
+	/* restore arrays */
+	for(j=0;j<maxpy_length;j++){
+		TRY( VecRestoreArrayRead(vectors[j],&(arrays[j])) );
+	}
+	for(j=0;j<2*elementwise_length;j++){
+		operand = (j%2 == 0) ? elementwise[j/2]->get_vector() : elementwise[j/2]->get_vector2();
+		if(operand){
+			TRY( VecRestoreArrayRead(operand,&(elementwise_arrays[j])) );
+		}
+	}
+	TRY( VecRestoreArray(y,&y_arr) );
+	if(maxpy_length > PETSCVECTOR_COMBSIZE){
+		TRY( PetscFree(arrays) );
+	}
+	if(elementwise_length > PETSCVECTOR_COMBSIZE){
+		TRY( PetscFree(elementwise_arrays) );
+	}
+
+	return !overlap;
+}
+
+/* y = scale*y + shift + sum(alphas*vectors) + sum(coeffs*op(x,z)) using temporary vectors, VecScale, VecShift and VecMAXPY */
+void PetscVectorWrapperComb::compute_petsc(Vec y, double scale, double shift, int maxpy_length, PetscScalar *alphas, Vec *vectors, int elementwise_length, const PetscVectorWrapperCombNode * const *elementwise) const {
+	TRACE_PETSCVECTOR("WrapperComb", "FUNCTION", "compute_petsc(Vec,double,double,int,double*,Vec*,int,WrapperCombNode**)");
+
+	PetscScalar coeffs_inline[PETSCVECTOR_COMBSIZE];
+	Vec temps_inline[PETSCVECTOR_COMBSIZE];
+	PetscScalar *coeffs = coeffs_inline;
+	Vec *temps = temps_inline;
+	Vec x, z;
+	int j;
+
+	/* evaluate elementwise nodes into temporary vectors before the result is changed (it could be an operand) */
+	if(elementwise_length > PETSCVECTOR_COMBSIZE){
+		TRY( PetscMalloc(sizeof(PetscScalar)*elementwise_length,&coeffs) );
+		TRY( PetscMalloc(sizeof(Vec)*elementwise_length,&temps) );
+	}
+	for(j=0;j<elementwise_length;j++){
+		x = elementwise[j]->get_vector();
+		z = elementwise[j]->get_vector2();
+		coeffs[j] = elementwise[j]->get_coeff();
+		POOL_PETSCVECTOR.checkout(x,&(temps[j]));
+
+		switch(elementwise[j]->get_type()){
+			case COMB_NODE_MUL:
+				TRY( VecPointwiseMult(temps[j],x,z) );
+				break;
+			case COMB_NODE_DIV:
+				TRY( VecPointwiseDivide(temps[j],x,z) );
+				break;
+			case COMB_NODE_ABS:
+				TRY( VecCopy(x,temps[j]) );
+				TRY( VecAbs(temps[j]) );
+				break;
+			case COMB_NODE_SQRT:
+				TRY( VecCopy(x,temps[j]) );
+				TRY( VecSqrtAbs(temps[j]) );
+				break;
+			case COMB_NODE_EXP:
+				TRY( VecCopy(x,temps[j]) );
+				TRY( VecExp(temps[j]) );
+				break;
+			case COMB_NODE_MIN:
+				TRY( VecPointwiseMin(temps[j],x,z) );
+				break;
+			case COMB_NODE_MAX:
+				TRY( VecPointwiseMax(temps[j],x,z) );
+				break;
+			default:
+				TRY( VecCopy(x,temps[j]) );
+				break;
+		}
+	}
 
 	/* scale the vector */
 	if(scale != 1.0){
@@ -168,214 +630,229 @@ void PetscVectorWrapperComb::compute(const Vec &y, double init_scale){
 		TRY( VecMAXPY(y,maxpy_length,alphas,vectors) );
 	}
 
-	/* free memory */
-	TRY(PetscFree(alphas));
-	TRY(PetscFree(vectors));
+	/* y += sum (coeffs*temps) */
+	if(elementwise_length > 0){
+		TRY( VecMAXPY(y,elementwise_length,coeffs,temps) );
+	}
 
+	for(j=0;j<elementwise_length;j++){
+		POOL_PETSCVECTOR.checkin(&(temps[j]));
+	}
+	if(elementwise_length > PETSCVECTOR_COMBSIZE){
+		TRY( PetscFree(coeffs) );
+		TRY( PetscFree(temps) );
+	}
 }
 
 
-/* print linear combination without instance, f.x << alpha*vec1 + beta*vec2 */
-std::ostream &operator<<(std::ostream &output, PetscVectorWrapperComb comb)
+/* print linear combination without instance, f.x << alpha*vec1 + beta*vec2,
+ * the combination is computed into temporary vector (from the pool) and printed in global order */
+std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperComb &comb)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)OPERATOR: << comb" << std::endl;
-		
-	PetscInt i,j,vector_size,list_size;
-	double value;
-	
-	std::list<PetscVectorWrapperCombNode>::iterator list_iter; /* iterator through list */
-		
-	output << "[";
-	
-	list_size = comb.get_listsize();
-	vector_size = comb.get_vectorsize();
-	
-	/* go through components in the vector */
-	for(i=0;i<vector_size;i++){
-		list_iter = comb.comb_list.begin();
-		
-		/* for each component go throught the list */
-		for(j=0;j<list_size;j++){
-			/* print coeff, if coeff < 0, then print it in () */
-			if(list_iter->get_coeff() < 0.0){
-				output << "(" << list_iter->get_coeff() << ")";
-			} else {
-				output << list_iter->get_coeff(); 
-			}
+	TRACE_PETSCVECTOR("WrapperComb", "OPERATOR", "<< comb");
 
-
-			/* maybe the vector = NULL, i.e. when comb+scalar is called */
-			if(list_iter->get_size() > 0){
-				output << "*";
-				/* print value, if value < 0, then print it in () */
-				value = list_iter->get_value(i);
-				if(value < 0.0){
-					output << "(" << value << ")";
-				} else {
-					output << value; 
-				}
-			}
-
-			if(j < list_size-1){ 
-				/* this is not the last node */
-				output << "+";
-				list_iter++;
-			}
-		}
-		
-		if(i < vector_size-1){ 
-			/* this is not the last element */
-			output << ", ";
-		}
+	/* there is no vector to get the layout from, i.e. the combination of scalars */
+	if(comb.get_vectorsize() == 0){
+		output << "[]";
+		return output;
 	}
 
-	output << "]";
+	PetscVector result(comb);
+	result.print(output);
 
 	return output;
 }
 
 /* all nodes in linear combination will be scaled */
-const PetscVectorWrapperComb operator*(double alpha, PetscVectorWrapperComb comb){
-	/* scale nodes in the list */
-	std::list<PetscVectorWrapperCombNode>::iterator list_iter; /* iterator through list */
-	int list_size = comb.get_listsize();
-	int j;
-
-	/* set to the begin of the list */
-	list_iter = comb.comb_list.begin();
+PetscVectorWrapperComb operator*(double alpha, const PetscVectorWrapperComb &comb){
+	PetscVectorWrapperComb result(comb);
+	result.scale(alpha);
+	
+	return result;
+}
 
-	/* go through the list and scale nodes */
-	for(j=0;j<list_size;j++){
-		list_iter->scale(alpha);
-		
-		if(j < list_size-1){
-			/* this is not the last element */
-			list_iter++;
-		}
-	}
+/* all nodes in temporary linear combination will be scaled in place */
+PetscVectorWrapperComb operator*(double alpha, PetscVectorWrapperComb &&comb){
+	comb.scale(alpha);
 	
-	return comb;
+	return std::move(comb);
 }
 
 /* new linear combination created by comb + comb */
-const PetscVectorWrapperComb operator+(PetscVectorWrapperComb comb1, PetscVectorWrapperComb comb2){
+PetscVectorWrapperComb operator+(const PetscVectorWrapperComb &comb1, const PetscVectorWrapperComb &comb2){
+	PetscVectorWrapperComb result(comb1);
+	
+	/* append second linear combination to the first */
+	result.merge(comb2);
+	
+	return result;
+}
+
+/* temporary comb + comb, append to the temporary combination */
+PetscVectorWrapperComb operator+(PetscVectorWrapperComb &&comb1, const PetscVectorWrapperComb &comb2){
 	/* append second linear combination to the first */
 	comb1.merge(comb2);
 	
-	return comb1;
+	return std::move(comb1);
 }
 
 /* new linear combination created by comb - comb */
-const PetscVectorWrapperComb operator-(PetscVectorWrapperComb comb1, PetscVectorWrapperComb comb2){
-	/* append second linear combination to the first */
-	comb2 = -1*comb2;
+PetscVectorWrapperComb operator-(const PetscVectorWrapperComb &comb1, const PetscVectorWrapperComb &comb2){
+	return PetscVectorWrapperComb(comb1) - comb2;
+}
+
+/* temporary comb - comb, append scaled nodes to the temporary combination */
+PetscVectorWrapperComb operator-(PetscVectorWrapperComb &&comb1, const PetscVectorWrapperComb &comb2){
+	int old_size = comb1.nodes_size;
+	int j;
+
+	/* append second linear combination to the first and change the sign of appended nodes */
 	comb1.merge(comb2);
+	PetscVectorWrapperCombNode *nodes = comb1.get_nodes();
+	for(j=old_size;j<comb1.nodes_size;j++){
+		nodes[j].scale(-1.0);
+	}
 	
-	return comb1;
+	return std::move(comb1);
 }
 
 /* new linear combination created by comb + scalar */
-const PetscVectorWrapperComb operator+(PetscVectorWrapperComb comb1, double scalar){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)OPERATOR: comb + scalar" << std::endl;
+PetscVectorWrapperComb operator+(const PetscVectorWrapperComb &comb1, double scalar){
+	return PetscVectorWrapperComb(comb1) + scalar;
+}
+
+/* temporary comb + scalar, append scalar node to the temporary combination */
+PetscVectorWrapperComb operator+(PetscVectorWrapperComb &&comb1, double scalar){
+	TRACE_PETSCVECTOR("WrapperComb", "OPERATOR", "comb + scalar");
 
-	/* prepare node, tell him to destroy the Vec at the end of the fun */
+	/* prepare node without vector */
 	PetscVectorWrapperCombNode temp_node(scalar);
 	
-	/* prepare new combination from node */
-	PetscVectorWrapperComb comb2(temp_node);
-	
-	/* append second linear combination to the first */
-	comb1.merge(comb2);
+	/* append it to the combination */
+	comb1.append(temp_node);
 	
-	return comb1;
+	return std::move(comb1);
 }
 
 /* new linear combination created by scalar+comb */
-const PetscVectorWrapperComb operator+(double scalar,PetscVectorWrapperComb comb2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperComb)OPERATOR: scalar + comb" << std::endl;
+PetscVectorWrapperComb operator+(double scalar, const PetscVectorWrapperComb &comb2){
+	TRACE_PETSCVECTOR("WrapperComb", "OPERATOR", "scalar + comb");
 
 	return comb2+scalar;
 }
 
+/* scalar + temporary comb */
+PetscVectorWrapperComb operator+(double scalar, PetscVectorWrapperComb &&comb2){
+	TRACE_PETSCVECTOR("WrapperComb", "OPERATOR", "scalar + comb");
+
+	return std::move(comb2)+scalar;
+}
+
 
 
 /* --------------------- PetscVectorWrapperCombNode ----------------------*/
 
-/* constructor default */
+/* constructor default, used in the storage of combination, therefore it is not traced */
 PetscVectorWrapperCombNode::PetscVectorWrapperCombNode(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)CONSTRUCTOR: default" << std::endl;
 
 }
 
 /* constructor from PetscVector */
 PetscVectorWrapperCombNode::PetscVectorWrapperCombNode(const PetscVector &vec){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)CONSTRUCTOR: (Vec)" << std::endl;
-	set_vector(vec.get_vector());
+	TRACE_PETSCVECTOR("WrapperCombNode", "CONSTRUCTOR", "(Vec)");
+	set_vector(vec.get_vector_shared());
 	set_coeff(1.0);
+	this->inner_vector2 = NULL;
+	this->type = COMB_NODE_VECTOR;
 	
 }
 
 /* constructor from vector and coefficient */
 PetscVectorWrapperCombNode::PetscVectorWrapperCombNode(double new_coeff, Vec new_vector){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)CONSTRUCTOR: (double,Vec)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "CONSTRUCTOR", "(double,Vec)");
 	set_vector(new_vector);
 	set_coeff(new_coeff);
+	this->inner_vector2 = NULL;
+	this->type = COMB_NODE_VECTOR;
 	
 }
 
 /* constructor coefficient */
 PetscVectorWrapperCombNode::PetscVectorWrapperCombNode(double new_coeff){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)CONSTRUCTOR: (double)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "CONSTRUCTOR", "(double)");
 
 	set_vector(NULL);
 	set_coeff(new_coeff);
+	this->inner_vector2 = NULL;
+	this->type = COMB_NODE_VECTOR;
+
+}
+
+/* constructor of elementwise operation coeff*op(x,z) */
+PetscVectorWrapperCombNode::PetscVectorWrapperCombNode(double new_coeff, PetscVectorWrapperCombNodeType new_type, Vec new_vector, Vec new_vector2){
+	TRACE_PETSCVECTOR("WrapperCombNode", "CONSTRUCTOR", "(double,type,Vec,Vec)");
+
+	set_vector(new_vector);
+	set_coeff(new_coeff);
+	this->inner_vector2 = new_vector2;
+	this->type = new_type;
 
 }
 
 /* destructor */
 PetscVectorWrapperCombNode::~PetscVectorWrapperCombNode(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)DESTRUCTOR" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "DESTRUCTOR", "");
 
 }
 
 /* set vector to the node */
 void PetscVectorWrapperCombNode::set_vector(Vec new_vector){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: set_vector(Vec)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "set_vector(Vec)");
 
 	this->inner_vector = new_vector;
 }
 
 /* return vector from this node */
 Vec PetscVectorWrapperCombNode::get_vector() const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: get_vector()" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "get_vector()");
 
 	return this->inner_vector;
 }
 
+/* return second operand from this node */
+Vec PetscVectorWrapperCombNode::get_vector2() const{
+	return this->inner_vector2;
+}
+
+/* return elementwise operation of this node */
+PetscVectorWrapperCombNodeType PetscVectorWrapperCombNode::get_type() const{
+	return this->type;
+}
+
 /* set new coefficient to this node */
 void PetscVectorWrapperCombNode::set_coeff(double new_coeff){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: set_coeff(double)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "set_coeff(double)");
 
 	this->coeff = new_coeff;
 }
 
 /* node is multiplied by scalar, now multiply only the coefficient of linear combination */
 void PetscVectorWrapperCombNode::scale(double alpha){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: scale(double)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "scale(double)");
 
 	this->coeff *= alpha;
 }
 
 /* get the coefficient from this node */
 double PetscVectorWrapperCombNode::get_coeff() const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: get_coeff()" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "get_coeff()");
 
 	return this->coeff;
 }
 
 /* get size of the vector */
 int PetscVectorWrapperCombNode::get_size() const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: get_size()" << std::endl;
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "get_size()");
 
 	int global_size;
 	if(this->inner_vector){
@@ -387,17 +864,37 @@ int PetscVectorWrapperCombNode::get_size() const{
 }
 
 /* get value from the vector, really slow */
-int PetscVectorWrapperCombNode::get_value(int index) const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperCombNode)FUNCTION: get_value(int)" << std::endl;
+double PetscVectorWrapperCombNode::get_value(int index) const{
+	TRACE_PETSCVECTOR("WrapperCombNode", "FUNCTION", "get_value(int)");
 
 	PetscInt ni = 1;
 	PetscInt ix[1];
 	PetscScalar y[1];
+	PetscScalar z[1];
 			
 	ix[0] = index;
 	TRY( VecGetValues(this->inner_vector,ni,ix,y) );	
+
+	z[0] = 0.0;
+	if(this->inner_vector2){
+		TRY( VecGetValues(this->inner_vector2,ni,ix,z) );	
+	}
 			
-	return y[0];
+	return evaluate(this->type, y[0], z[0]);
+}
+
+/* apply elementwise operation to one component */
+double PetscVectorWrapperCombNode::evaluate(PetscVectorWrapperCombNodeType type, double x, double z){
+	switch(type){
+		case COMB_NODE_MUL: return x*z;
+		case COMB_NODE_DIV: return (z != 0.0) ? x/z : 0.0;
+		case COMB_NODE_ABS: return std::fabs(x);
+		case COMB_NODE_SQRT: return std::sqrt(std::fabs(x));
+		case COMB_NODE_EXP: return std::exp(x);
+		case COMB_NODE_MIN: return (x < z) ? x : z;
+		case COMB_NODE_MAX: return (x > z) ? x : z;
+		default: return x;
+	}
 }
 
 
@@ -0,0 +1,56 @@
+#ifndef PETSCVECTOR_WRAPPERDIV_IMPL_H
+#define	PETSCVECTOR_WRAPPERDIV_IMPL_H
+
+
+namespace petscvector {
+
+/* PetscVectorWrapperDiv constructor, only store the operands */
+PetscVectorWrapperDiv::PetscVectorWrapperDiv(Vec new_inner_vector1, Vec new_inner_vector2){
+	TRACE_PETSCVECTOR("WrapperDiv", "CONSTRUCTOR", "WrapperDiv(inner_vec1, inner_vec2)");
+
+	inner_vector1 = new_inner_vector1; 
+	inner_vector2 = new_inner_vector2; 
+}
+
+/* PetscVectorWrapperDiv destructor */
+PetscVectorWrapperDiv::~PetscVectorWrapperDiv(){
+
+}
+
+/* compute the division into given vector, this function is called from overloaded operator */
+void PetscVectorWrapperDiv::div(Vec result) const{
+	TRACE_PETSCVECTOR("WrapperDiv", "FUNCTION", "div(Vec result)");
+
+#ifdef PETSCVECTOR_OPENMP
+	/* the fused combination with one elementwise node is computed by threads */
+	if(FUSED_MODE_PETSCVECTOR){
+		PetscVectorWrapperComb(*this).compute(result, 0.0);
+		return;
+	}
+#endif
+	TRY( VecPointwiseDivide(result, inner_vector1, inner_vector2) );
+}
+
+Vec PetscVectorWrapperDiv::get_vector1() const {
+	return inner_vector1;
+}
+
+Vec PetscVectorWrapperDiv::get_vector2() const {
+	return inner_vector2;
+}
+
+/* stream insertion << operator, the result has to be stored somewhere */
+std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperDiv &div)
+{
+	TRACE_PETSCVECTOR("WrapperDiv", "OPERATOR", "<<");
+
+	PetscVector result(div);
+	result.print(output);
+
+	return output;
+}
+
+
+} /* end of petscvector namespace */
+
+#endif
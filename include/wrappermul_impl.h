@@ -6,7 +6,7 @@ namespace petscvector {
 
 /* PetscVectorWrapperSub constructor with given IS = create subvector */
 PetscVectorWrapperMul::PetscVectorWrapperMul(Vec new_inner_vector1, Vec new_inner_vector2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperMul)CONSTRUCTOR: WrapperMul(inner_vec1, inner_vec2)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperMul", "CONSTRUCTOR", "WrapperMul(inner_vec1, inner_vec2)");
 
 	inner_vector1 = new_inner_vector1; 
 	inner_vector2 = new_inner_vector2; 
@@ -19,9 +19,16 @@ PetscVectorWrapperMul::~PetscVectorWrapperMul(){
 
 /* set all values of the subvector, this function is called from overloaded operator */
 void PetscVectorWrapperMul::mul(Vec result){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: mul(Vec result)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "mul(Vec result)");
 
 	// TODO: control if vectors were allocated
+#ifdef PETSCVECTOR_OPENMP
+	/* the fused combination with one elementwise node is computed by threads */
+	if(FUSED_MODE_PETSCVECTOR){
+		PetscVectorWrapperComb(*this).compute(result, 0.0);
+		return;
+	}
+#endif
 	TRY( VecPointwiseMult(result, inner_vector1, inner_vector2) );
 
 
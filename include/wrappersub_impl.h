@@ -5,8 +5,11 @@
 namespace petscvector {
 
 /* PetscVectorWrapperSub constructor with given IS = create subvector */
-PetscVectorWrapperSub::PetscVectorWrapperSub(Vec new_inner_vector, IS new_subvector_is, bool new_free_is){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)CONSTRUCTOR: WrapperSub(inner_vec, IS)" << std::endl;
+PetscVectorWrapperSub::PetscVectorWrapperSub(Vec new_inner_vector, IS new_subvector_is, bool new_free_is, const PetscVector *new_owner, bool new_replicated){
+	TRACE_PETSCVECTOR("WrapperSub", "CONSTRUCTOR", "WrapperSub(inner_vec, IS)");
+
+	/* the owner is asked for its own inner vector when the values are changed */
+	owner = new_owner;
 
 	/* free index set during destruction ? */
 	free_is = new_free_is;
@@ -17,51 +20,295 @@ PetscVectorWrapperSub::PetscVectorWrapperSub(Vec new_inner_vector, IS new_subvec
 	/* copy IS */
 	subvector_is = new_subvector_is;
 
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - get subvector from original vector" << std::endl;
+	shared_inner_vector = NULL;
+	shared_subvector = NULL;
+	shared_view_array = NULL;
+
+	/* the slice owned by one process is a view, the others (and general index sets) are taken by VecGetSubVector */
+	replicated = new_replicated;
+	view_rank = new_replicated ? get_view_rank() : -1;
 
 	/* get subvector, restore it in destructor */
-	TRY( VecGetSubVector(inner_vector, subvector_is, &subvector) );
-	
+	get_subvector_of(inner_vector, &subvector, &view_array);
+}
+
+/* PetscVectorWrapperSub constructor of vec(all) = the operations are performed with original vector */
+PetscVectorWrapperSub::PetscVectorWrapperSub(Vec new_inner_vector, const PetscVector *new_owner){
+	TRACE_PETSCVECTOR("WrapperSub", "CONSTRUCTOR", "WrapperSub(inner_vec)");
+
+	owner = new_owner;
+	inner_vector = new_inner_vector;
+	subvector = new_inner_vector;
+
+	subvector_is = NULL;
+	free_is = false;
+	replicated = false;
+	view_rank = -1;
+	view_array = NULL;
+
+	shared_inner_vector = NULL;
+	shared_subvector = NULL;
+	shared_view_array = NULL;
+}
+
+/* the moved wrapper looks like an alias without index set, its destructor does nothing */
+PetscVectorWrapperSub::PetscVectorWrapperSub(PetscVectorWrapperSub &&subvec){
+	TRACE_PETSCVECTOR("WrapperSub", "CONSTRUCTOR", "move");
+
+	inner_vector = subvec.inner_vector;
+	subvector = subvec.subvector;
+	subvector_is = subvec.subvector_is;
+	owner = subvec.owner;
+	free_is = subvec.free_is;
+	replicated = subvec.replicated;
+	view_rank = subvec.view_rank;
+	view_array = subvec.view_array;
+	shared_inner_vector = subvec.shared_inner_vector;
+	shared_subvector = subvec.shared_subvector;
+	shared_view_array = subvec.shared_view_array;
+
+	subvec.subvector = NULL;
+	subvec.subvector_is = NULL;
+	subvec.free_is = false;
+	subvec.view_array = NULL;
+	subvec.shared_inner_vector = NULL;
+	subvec.shared_subvector = NULL;
+	subvec.shared_view_array = NULL;
 }
 
 /* PetscVectorWrapperSub destructor */
 PetscVectorWrapperSub::~PetscVectorWrapperSub(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)DESTRUCTOR: ~WrapperSub" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "DESTRUCTOR", "~WrapperSub");
+
+	if(!subvector_is){
+		/* alias of original vector, there is nothing to restore */
+		TRACE_NOTE_PETSCVECTOR("alias");
+	} else {
+		/* if this was a subvector, then restore values */
+		restore_subvector_of(inner_vector, &subvector, &view_array);
+	}
 
-	/* if this was a subvector, then restore values */
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - restore subvector" << std::endl;
-	TRY( VecRestoreSubVector(inner_vector, subvector_is, &subvector) );
+	release_shared();
 
 	/* if it is necessary to free IS, then free it */
 	if(free_is){
-		if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - destroy IS" << std::endl;
+		TRACE_NOTE_PETSCVECTOR("destroy IS");
 		TRY( ISDestroy(&subvector_is) );
 	}
 
 }
 
+/* the subvector was taken from the shared vector, it has to be taken again from the own copy of the owner */
+void PetscVectorWrapperSub::unshare() const{
+	if(!owner || !owner->shared){
+		return;
+	}
+
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "unshare()");
+
+	/* the nodes of combinations (e.g. s += 2*s) could already hold the subvector of shared vector,
+	 * it has the same values as the new copy, therefore it is kept (with the shared vector) until the destructor */
+	Vec old_inner_vector = inner_vector;
+	TRY( PetscObjectReference((PetscObject)old_inner_vector) );
+
+	owner->unshare();
+
+	/* the other copies were already destroyed, the vector was not copied */
+	if(owner->inner_vector == old_inner_vector){
+		TRY( VecDestroy(&old_inner_vector) );
+		return;
+	}
+
+	release_shared();
+	shared_inner_vector = old_inner_vector;
+	shared_subvector = subvector_is ? subvector : NULL;
+	shared_view_array = view_array;
+
+	inner_vector = owner->inner_vector;
+	if(subvector_is){
+		get_subvector_of(inner_vector, &subvector, &view_array);
+	} else {
+		subvector = inner_vector;
+	}
+}
+
+/* restore the subvector of shared vector and release the shared vector */
+void PetscVectorWrapperSub::release_shared() const{
+	if(shared_subvector){
+		restore_subvector_of(shared_inner_vector, &shared_subvector, &shared_view_array);
+	}
+	if(shared_inner_vector){
+		TRY( VecDestroy(&shared_inner_vector) );
+	}
+}
+
+/* the slice of components [first, first+n) which is owned by one process, -1 if it crosses the boundary of processes;
+ * every process has the same stride index set and the same ownership ranges, therefore all of them find the same one */
+int PetscVectorWrapperSub::get_view_rank() const{
+	MPI_Comm comm;
+	PetscBool is_stride;
+	PetscInt first, step, n;
+	const PetscInt *ranges;
+	int nproc, r;
+
+	TRY( PetscObjectTypeCompare((PetscObject)subvector_is, ISSTRIDE, &is_stride) );
+	if(!is_stride){
+		return -1;
+	}
+
+	TRY( ISStrideGetInfo(subvector_is, &first, &step) );
+	TRY( ISGetLocalSize(subvector_is, &n) );
+	if(n < 1 || (step != 1 && n > 1)){
+		return -1;
+	}
+
+	TRY( PetscObjectGetComm((PetscObject)inner_vector, &comm) );
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( VecGetOwnershipRanges(inner_vector, &ranges) );
+	for(r=0; r < nproc; r++){
+		if(ranges[r] <= first && first + n <= ranges[r+1]){
+			return r;
+		}
+	}
+
+	return -1;
+}
+
+/* get the subvector of given original vector, the view is created without VecGetSubVector */
+void PetscVectorWrapperSub::get_subvector_of(Vec vec, Vec *sub, PetscScalar **array) const{
+	if(view_rank < 0){
+		TRACE_NOTE_PETSCVECTOR("get subvector from original vector");
+
+		/* the values are scattered (copied) to every process */
+		*array = NULL;
+		TRY( VecGetSubVector(vec, subvector_is, sub) );
+		return;
+	}
+
+	TRACE_NOTE_PETSCVECTOR("create view to original vector");
+
+	MPI_Comm comm;
+	PetscInt first, step, n;
+	const PetscInt *ranges;
+	PetscScalar *values;
+	int rank, nproc;
+
+	TRY( PetscObjectGetComm((PetscObject)vec, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( ISStrideGetInfo(subvector_is, &first, &step) );
+	TRY( ISGetLocalSize(subvector_is, &n) );
+
+	/* the owner uses its array directly (restored in destructor), the others get the copy of the values (as from VecGetSubVector) */
+	if(rank == view_rank){
+		TRY( VecGetOwnershipRanges(vec, &ranges) );
+		TRY( VecGetArray(vec, array) );
+		values = *array + (first - ranges[rank]);
+	} else {
+		TRY( PetscMalloc1(n, array) );
+		values = *array;
+	}
+	TRY( MPI_Bcast(values, n, MPIU_SCALAR, view_rank, comm) );
+
+	/* the same layout as the subvector of VecGetSubVector, every process has all components of the slice */
+	TRY( VecCreateMPIWithArray(comm, 1, n, n*nproc, values, sub) );
+
+	/* remember the slice on all processes, the views of the same original vector could share the array */
+	TRY( PetscObjectCompose((PetscObject)*sub, "PetscVectorViewOf", (PetscObject)vec) );
+	TRY( PetscObjectCompose((PetscObject)*sub, "PetscVectorViewIS", (PetscObject)subvector_is) );
+}
+
+/* the vector is a view created by get_subvector_of */
+bool PetscVectorWrapperSub::is_view(Vec vec){
+	PetscObject original = NULL;
+
+	if(vec){
+		TRY( PetscObjectQuery((PetscObject)vec, "PetscVectorViewOf", &original) );
+	}
+	return (original != NULL);
+}
+
+/* compare the slices of two views, 0 if they are independent, 1 if they are the same, 2 if they overlap */
+int PetscVectorWrapperSub::compare_views(Vec vec1, Vec vec2){
+	PetscObject original1, original2, is1, is2;
+	PetscInt first1, first2, step, n1, n2;
+
+	if(!vec1 || !vec2 || vec1 == vec2){
+		return 0;
+	}
+
+	TRY( PetscObjectQuery((PetscObject)vec1, "PetscVectorViewOf", &original1) );
+	TRY( PetscObjectQuery((PetscObject)vec2, "PetscVectorViewOf", &original2) );
+	if(!original1 || original1 != original2){
+		return 0;
+	}
+
+	TRY( PetscObjectQuery((PetscObject)vec1, "PetscVectorViewIS", &is1) );
+	TRY( PetscObjectQuery((PetscObject)vec2, "PetscVectorViewIS", &is2) );
+	TRY( ISStrideGetInfo((IS)is1, &first1, &step) );
+	TRY( ISStrideGetInfo((IS)is2, &first2, &step) );
+	TRY( ISGetLocalSize((IS)is1, &n1) );
+	TRY( ISGetLocalSize((IS)is2, &n2) );
+
+	if(first1 == first2 && n1 == n2){
+		return 1;
+	}
+	if(first1 < first2 + n2 && first2 < first1 + n1){
+		return 2;
+	}
+	return 0;
+}
+
+/* restore the subvector of given original vector */
+void PetscVectorWrapperSub::restore_subvector_of(Vec vec, Vec *sub, PetscScalar **array) const{
+	if(view_rank < 0){
+		TRACE_NOTE_PETSCVECTOR("restore subvector");
+
+		TRY( VecRestoreSubVector(vec, subvector_is, sub) );
+		return;
+	}
+
+	TRACE_NOTE_PETSCVECTOR("destroy view");
+
+	MPI_Comm comm;
+	int rank;
+
+	TRY( PetscObjectGetComm((PetscObject)vec, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+
+	/* the values were changed directly in the array of the owner, the copies of other processes are forgotten */
+	TRY( VecDestroy(sub) );
+	if(rank == view_rank){
+		TRY( VecRestoreArray(vec, array) );
+	} else {
+		TRY( PetscFree(*array) );
+	}
+}
+
 /* set all values of the subvector, this function is called from overloaded operator */
 void PetscVectorWrapperSub::set(double new_value){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: set(double)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "set(double)");
 
 	// TODO: control if subvector was allocated
 
+	unshare();
+
 	TRY( VecSet(this->subvector,new_value) );
 
 	valuesUpdate();
 }
 
 /* return vector from this node */
-Vec PetscVectorWrapperSub::get_subvector(){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: get_subvector()" << std::endl;	
+Vec PetscVectorWrapperSub::get_subvector() const{
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "get_subvector()");
 	
 	return this->subvector;
 }
 
 /* get single value with given id of the vector (works only with local id), really slow */
-double PetscVectorWrapperSub::get(int i)
+double PetscVectorWrapperSub::get(int i) const
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: get(int)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "get(int)");
 
 	PetscInt ni = 1;
 	PetscInt ix[1];
@@ -76,7 +323,7 @@ double PetscVectorWrapperSub::get(int i)
 
 /* after update a variable, it is necessary to call asseble begin & end */
 void PetscVectorWrapperSub::valuesUpdate() const {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: valuesUpdate()" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "valuesUpdate()");
 
 	TRY( VecAssemblyBegin(subvector) );
 	TRY( VecAssemblyEnd(subvector) );
@@ -84,37 +331,93 @@ void PetscVectorWrapperSub::valuesUpdate() const {
 
 /* subvector = alpha*subvector */
 void PetscVectorWrapperSub::scale(PetscScalar alpha) const{
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)FUNCTION: scale(double)" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "FUNCTION", "scale(double)");
 
 	//TODO: control subvector
 
+	unshare();
 	TRY( VecScale(subvector, alpha) );
 	valuesUpdate(); // TODO: has to be called?
 }
 
-/* stream insertion << operator */
+/* stream insertion << operator, the components (with their indices in original vector) are sent to the first process 
+ * in chunks and printed in global order, the replicated slice is printed only from the first process */
 std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperSub &wrapper)		
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: <<" << std::endl;
-
-	PetscScalar *arr_vector;
-	PetscInt i,local_size;
-	const PetscInt *indices;
-
-	output << "[";
-	TRY( VecGetLocalSize(wrapper.subvector,&local_size) );
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "<<");
+
+	MPI_Comm comm;
+	MPI_Status status;
+	const PetscScalar *arr;
+	const PetscScalar *values;
+	const PetscInt *indices = NULL;
+	const PetscInt *chunk_indices = NULL;
+	PetscScalar values_chunk[PETSCVECTOR_PRINTCHUNK];
+	PetscInt indices_chunk[PETSCVECTOR_PRINTCHUNK];
+	const PetscInt *ranges;
+	int rank, nproc, r, i, j, count, local_size;
+	bool first = true;
+
+	TRY( PetscObjectGetComm((PetscObject)wrapper.subvector, &comm) );
+	TRY( MPI_Comm_rank(comm, &rank) );
+	TRY( MPI_Comm_size(comm, &nproc) );
+	TRY( VecGetOwnershipRanges(wrapper.subvector, &ranges) );
+	TRY( VecGetArrayRead(wrapper.subvector, &arr) );
+	if(wrapper.subvector_is){
+		TRY( ISGetIndices(wrapper.subvector_is, &indices) );
+	}
 
-	TRY( VecGetArray(wrapper.subvector,&arr_vector) );
-	TRY( ISGetIndices(wrapper.subvector_is,&indices) );
+	/* every process has all components of the replicated slice */
+	if(wrapper.replicated){
+		nproc = 1;
+	}
 
-	for (i=0; i<local_size; i++){
-		output << "{" << indices[i] << "}=" << arr_vector[i];
-		if(i < local_size-1) output << ", ";
+	if(rank != 0){
+		if(rank < nproc){
+			local_size = ranges[rank+1] - ranges[rank];
+			for(i=0;i<local_size;i+=PETSCVECTOR_PRINTCHUNK){
+				count = (local_size - i < PETSCVECTOR_PRINTCHUNK) ? local_size - i : PETSCVECTOR_PRINTCHUNK;
+				if(indices){
+					TRY( MPI_Send((void*)(indices + i), count, MPIU_INT, 0, 0, comm) );
+				}
+				TRY( MPI_Send((void*)(arr + i), count, MPIU_SCALAR, 0, 0, comm) );
+			}
+		}
+	} else {
+		output << "[";
+
+		for(r=0;r<nproc;r++){
+			local_size = ranges[r+1] - ranges[r];
+			for(i=0;i<local_size;i+=PETSCVECTOR_PRINTCHUNK){
+				count = (local_size - i < PETSCVECTOR_PRINTCHUNK) ? local_size - i : PETSCVECTOR_PRINTCHUNK;
+				if(r == 0){
+					chunk_indices = indices ? indices + i : NULL;
+					values = arr + i;
+				} else {
+					if(indices){
+						TRY( MPI_Recv(indices_chunk, count, MPIU_INT, r, 0, comm, &status) );
+						chunk_indices = indices_chunk;
+					}
+					TRY( MPI_Recv(values_chunk, count, MPIU_SCALAR, r, 0, comm, &status) );
+					values = values_chunk;
+				}
+
+				/* alias of original vector, the indices are given by the ownership */
+				for(j=0;j<count;j++){
+					if(!first) output << ", ";
+					output << "{" << (chunk_indices ? chunk_indices[j] : ranges[r]+i+j) << "}=" << values[j];
+					first = false;
+				}
+			}
+		}
+
+		output << "]";
 	}
 
-	TRY( ISRestoreIndices(wrapper.subvector_is,&indices) );
-	TRY( VecRestoreArray(wrapper.subvector,&arr_vector) );
-	output << "]";
+	if(wrapper.subvector_is){
+		TRY( ISRestoreIndices(wrapper.subvector_is, &indices) );
+	}
+	TRY( VecRestoreArrayRead(wrapper.subvector, &arr) );
 			
 	return output;
 }
@@ -122,15 +425,15 @@ std::ostream &operator<<(std::ostream &output, const PetscVectorWrapperSub &wrap
 
 /* subvec = scalar_value <=> subvec(all) = scalar_value, assignment operator */
 PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(double scalar_value){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: (subvec = double)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "(subvec = double)");
 
 	this->set(scalar_value);
 	return *this;	
 }
 
 /* subvec1 = subvec2, assignment operator (set subvector) */
-PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(PetscVectorWrapperSub subvec2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: (subvec = subvec)" << std::endl;
+PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVectorWrapperSub &subvec2){
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "(subvec = subvec)");
 
 	/* vec1 is not initialized yet */
 	if (!subvector){
@@ -138,9 +441,25 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(PetscVectorWrapperSub su
 	}
 
 	/* else copy the values of inner vectors */
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - copy values" << std::endl;		
+	TRACE_NOTE_PETSCVECTOR("copy values");
 	
-	VecCopy(subvec2.get_subvector(),subvector);
+	unshare();
+
+	/* the overlapping views share the array, the values are copied through temporary vector */
+	Vec temp;
+	switch(compare_views(subvec2.get_subvector(), subvector)){
+		case 1:
+			break;
+		case 2:
+			POOL_PETSCVECTOR.checkout(subvector, &temp);
+			TRY( VecCopy(subvec2.get_subvector(), temp) );
+			TRY( VecCopy(temp, subvector) );
+			POOL_PETSCVECTOR.checkin(&temp);
+			break;
+		default:
+			VecCopy(subvec2.get_subvector(),subvector);
+			break;
+	}
 	this->valuesUpdate(); // TODO: has to be called?
 	
 	return *this;	
@@ -149,7 +468,7 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(PetscVectorWrapperSub su
 
 /* subvec1 = vec2, assignment operator (set vector) */
 PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVector &vec2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: (subvec = vec)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "(subvec = vec)");
 
 	/* vec1 is not initialized yet */
 	if (!subvector){
@@ -157,9 +476,10 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVector &vec2)
 	}
 
 	/* else copy the values of inner vectors */
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - copy values" << std::endl;		
+	TRACE_NOTE_PETSCVECTOR("copy values");
 	
-	VecCopy(vec2.get_vector(),subvector); // TODO: I dont know how to do without this
+	unshare();
+	VecCopy(vec2.get_vector_shared(),subvector); // TODO: I dont know how to do without this
 	this->valuesUpdate(); // TODO: has to be called?
 	
 	return *this;	
@@ -169,7 +489,7 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVector &vec2)
 
 /* vec1 = linear_combination_node, perform simple linear combination */
 //PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVectorWrapperCombNode combnode){
-//	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: (subvec = combnode)" << std::endl;
+//	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "(subvec = combnode)");
 
 	/* vec1 is not initialized yet */
 //	if (!subvector){
@@ -177,7 +497,7 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVector &vec2)
 //	}
 
 	/* else copy the vector values and then scale */
-//	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << " - copy values" << std::endl;		
+//	TRACE_NOTE_PETSCVECTOR("copy values");
 
 //	TRY( VecCopy(combnode.get_vector(),subvector));
 	
@@ -187,8 +507,8 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVector &vec2)
 //}
 
 /* vec1 = linear_combination, perform full linear combination */
-PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(PetscVectorWrapperComb comb){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: (subvec = comb)" << std::endl;
+PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVectorWrapperComb &comb){
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "(subvec = comb)");
 
 	/* vec1 is not initialized yet */
 	if (!subvector){
@@ -196,40 +516,61 @@ PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(PetscVectorWrapperComb c
 	}
 
 	/* vec = comb */
+	unshare();
 	comb.compute(subvector,0.0);
 
 	return *this;	
 }
 
+/* subvec = vec1/vec2 */
+PetscVectorWrapperSub &PetscVectorWrapperSub::operator=(const PetscVectorWrapperDiv &div){
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "(subvec = div)");
+
+	unshare();
+	div.div(subvector);
+
+	return *this;	
+}
+
 /* subvec *= alpha */
 void operator*=(const PetscVectorWrapperSub &subvec1, double alpha)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec *= double" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec *= double");
 	
 	subvec1.scale(alpha);
 }
 
 /* vec1 += comb */
-void operator+=(const PetscVectorWrapperSub &subvec, PetscVectorWrapperComb comb)
+void operator+=(const PetscVectorWrapperSub &subvec, const PetscVectorWrapperComb &comb)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(PetscVector)OPERATOR: vec += comb" << std::endl;
+	TRACE_PETSCVECTOR("PetscVector", "OPERATOR", "vec += comb");
 	
+	subvec.unshare();
 	comb.compute(subvec.subvector,1.0);
 }
 
 /* subvec1 -= comb */
-void operator-=(const PetscVectorWrapperSub &subvec1, PetscVectorWrapperComb comb)
+void operator-=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperComb &comb)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: subvec -= comb" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec -= comb");
 	
 	subvec1 += (-1.0)*comb;
 }
 
+/* subvec1 -= temporary comb, the combination is scaled in place */
+void operator-=(const PetscVectorWrapperSub &subvec1, PetscVectorWrapperComb &&comb)
+{
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec -= comb");
+	
+	subvec1 += (-1.0)*std::move(comb);
+}
+
 /* vec1 = vec1./subvec2 */
-void operator/=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub subvec2)
+void operator/=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: vec1/vec2" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "vec1/vec2");
 
+	subvec1.unshare();
 	TRY(VecPointwiseDivide(subvec1.subvector,subvec1.subvector,subvec2.subvector) );
 
 	subvec1.valuesUpdate(); // TODO: has to be called?
@@ -238,8 +579,8 @@ void operator/=(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSu
 
 
 /* subvec == scalar */
-bool operator==(PetscVectorWrapperSub subvec, double alpha){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: subvec == double" << std::endl;	
+bool operator==(const PetscVectorWrapperSub &subvec, double alpha){
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec == double");
 	
 	bool return_value = false; // TODO: works only with vector of size 1, otherwise compare only first value
 	double vector_value = subvec.get(0);
@@ -252,8 +593,8 @@ bool operator==(PetscVectorWrapperSub subvec, double alpha){
 }
 
 /* vec1 == vec2 */
-bool operator==(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: subvec1 == subvec2" << std::endl;
+bool operator==(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2){
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec1 == subvec2");
 
 	PetscBool return_value;
 
@@ -263,8 +604,8 @@ bool operator==(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2){
 }
 
 /* subvec1 > subvec2 */
-bool operator>(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2){
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)OPERATOR: subvec1 > subvec2" << std::endl;
+bool operator>(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2){
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec1 > subvec2");
 
 	bool return_value = false; // TODO: works only with vector of size 1, otherwise compare only first value
 	
@@ -280,9 +621,9 @@ bool operator>(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2){
 }
 
 /* sum = sum(subvec1) */
-double sum(const PetscVectorWrapperSub subvec1)
+double sum(const PetscVectorWrapperSub &subvec1)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: sum(subvec)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "sum(subvec)");
 
 	double sum_value;
 	TRY( VecSum(subvec1.subvector,&sum_value) );
@@ -290,39 +631,65 @@ double sum(const PetscVectorWrapperSub subvec1)
 }
 
 /* dot = dot(subvec1,subvec2) */
-double dot(const PetscVectorWrapperSub subvec1, const PetscVectorWrapperSub subvec2)
+double dot(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: dot(subvec1,subvec2)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "dot(subvec1,subvec2)");
 
 	double dot_value;
 	TRY( VecDot(subvec1.subvector,subvec2.subvector,&dot_value));
 	return dot_value;
 }
 
-double dot(const PetscVector &x, const PetscVectorWrapperSub y)
+double dot(const PetscVector &x, const PetscVectorWrapperSub &y)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: dot(vec,subvec)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "dot(vec,subvec)");
 
 	double dot_value;
+	x.valuesUpdate();
 	TRY( VecDot(x.inner_vector,y.subvector,&dot_value));
 	return dot_value;
 }
 
-double dot(const PetscVectorWrapperSub x, const PetscVector &y)
+double dot(const PetscVectorWrapperSub &x, const PetscVector &y)
 {
-	if(DEBUG_MODE_PETSCVECTOR >= 100) std::cout << "(WrapperSub)FUNCTION: dot(subvec,vec)" << std::endl;
+	TRACE_PETSCVECTOR("WrapperSub", "FUNCTION", "dot(subvec,vec)");
 
 	double dot_value;
+	y.valuesUpdate();
 	TRY( VecDot(y.inner_vector,x.subvector,&dot_value));
 	return dot_value;
 }
 
 
-PetscVectorWrapperMul mul(PetscVectorWrapperSub subvec1, PetscVectorWrapperSub subvec2)
+PetscVectorWrapperMul mul(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2)
 {
 	return PetscVectorWrapperMul( subvec1.subvector, subvec2.subvector);
 }
 
+/* vec/subvec, the division is performed in the assignment */
+PetscVectorWrapperDiv operator/(const PetscVector &vec1, const PetscVectorWrapperSub &subvec2)
+{
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "vec/subvec returns WrapperDiv");
+
+	return PetscVectorWrapperDiv( vec1.get_vector_shared(), subvec2.subvector);
+}
+
+/* subvec/vec */
+PetscVectorWrapperDiv operator/(const PetscVectorWrapperSub &subvec1, const PetscVector &vec2)
+{
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec/vec returns WrapperDiv");
+
+	return PetscVectorWrapperDiv( subvec1.subvector, vec2.get_vector_shared());
+}
+
+/* subvec/subvec */
+PetscVectorWrapperDiv operator/(const PetscVectorWrapperSub &subvec1, const PetscVectorWrapperSub &subvec2)
+{
+	TRACE_PETSCVECTOR("WrapperSub", "OPERATOR", "subvec/subvec returns WrapperDiv");
+
+	return PetscVectorWrapperDiv( subvec1.subvector, subvec2.subvector);
+}
+
 } /* end of petscvector namespace */
 
 #endif
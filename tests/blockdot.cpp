@@ -0,0 +1,71 @@
+#include "petscvector.h"
+
+using namespace petscvector;
+
+extern int petscvector::DEBUG_MODE_PETSCVECTOR;
+extern bool petscvector::PETSC_INITIALIZED;
+
+int main( int argc, char *argv[] )
+{
+	DEBUG_MODE_PETSCVECTOR = 0;
+
+	int n = 5;
+
+	PetscInitialize(&argc,&argv,PETSC_NULL,PETSC_NULL);
+	petscvector::PETSC_INITIALIZED = true;
+	
+    // allocate storage
+    PetscVector H(n);
+    PetscVector D(H);
+    PetscVector E(H);
+
+    // initialize input vectors
+    H(0) = 3;  D(0) = 6;
+    H(1) = 4;  D(1) = 7;
+    H(2) = 0;  D(2) = 2;
+    H(3) = 8;  D(3) = 1;
+    H(4) = 2;  D(4) = 8;
+    E = H - D;
+
+	// all products of two groups are computed with one global communication
+	const PetscVector *x[2] = {&H, &D};
+	const PetscVector *y[3] = {&H, &D, &E};
+	double result[2*3];
+	block_dot(2, x, 3, y, result);
+	for(int j=0; j < 3; j++){
+		for(int i=0; i < 2; i++){
+		    std::cout << "block_dot(" << i << "," << j << "): " << result[i+2*j] << " (" << dot(*x[i],*y[j]) << ")" << std::endl;
+		}
+	}
+
+	// symmetric variant, only the upper triangle is reduced
+	double g[3*3];
+	gram(3, y, g);
+	for(int j=0; j < 3; j++){
+		for(int i=0; i < 3; i++){
+		    std::cout << "gram(" << i << "," << j << "): " << g[i+3*j] << " (" << dot(*y[i],*y[j]) << ")" << std::endl;
+		}
+	}
+
+	// the same products of columns of multivectors
+	PetscMultiVector X(H, 2), Y(H, 3);
+	X(0) = H; X(1) = D;
+	Y(0) = H; Y(1) = D; Y(2) = E;
+	block_dot(X, Y, result);
+	gram(Y, g);
+	for(int j=0; j < 3; j++){
+		for(int i=0; i < 2; i++){
+		    std::cout << "multivector block_dot(" << i << "," << j << "): " << result[i+2*j] << " (" << dot(X(i),Y(j)) << ")" << std::endl;
+		}
+	}
+	for(int j=0; j < 3; j++){
+		for(int i=0; i < 3; i++){
+		    std::cout << "multivector gram(" << i << "," << j << "): " << g[i+3*j] << " (" << dot(Y(i),Y(j)) << ")" << std::endl;
+		}
+	}
+
+	petscvector::PETSC_INITIALIZED = false;
+	PetscFinalize();
+
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include "petscvector.h"
+
+using namespace petscvector;
+
+extern int petscvector::DEBUG_MODE_PETSCVECTOR;
+extern bool petscvector::PETSC_INITIALIZED;
+
+int main( int argc, char *argv[] )
+{
+	DEBUG_MODE_PETSCVECTOR = 0;
+
+	int n = 5;
+
+	PetscInitialize(&argc,&argv,PETSC_NULL,PETSC_NULL);
+	petscvector::PETSC_INITIALIZED = true;
+	
+    // allocate storage
+    PetscVector H(n);
+
+    // initialize input vector
+    H(0) = 3;
+    H(1) = 4;
+    H(2) = 0;
+    H(3) = 8;
+    H(4) = 2;
+
+	// the file is written in the background, the vector could be changed immediately
+	PetscVectorCheckpoint checkpoint = H.save_binary_async("checkpoint_H.bin");
+	H = 2*H;
+	bool written = checkpoint.wait();
+    std::cout << "written:   " << written << std::endl;
+    std::cout << "H:" << H << std::endl;
+
+	// the checkpoint is the file in PETSc binary format
+	PetscVector A, B, C;
+	A.load_global("checkpoint_H.bin");
+	B.load_parallel("checkpoint_H.bin");
+	C.load_local_mapped("checkpoint_H.bin");
+    std::cout << "load_global:" << A << std::endl;
+    std::cout << "load_parallel:" << B << std::endl;
+    std::cout << "load_local_mapped:" << C << std::endl;
+
+	// the file in native byte order is mapped without copying
+	H.save_binary_native("native_H.bin");
+	PetscVector N;
+	N.load_local_mapped("native_H.bin");
+    std::cout << "native:" << N << std::endl;
+
+	petscvector::PETSC_INITIALIZED = false;
+	PetscFinalize();
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+#include "petscvector.h"
+
+using namespace petscvector;
+
+extern int petscvector::DEBUG_MODE_PETSCVECTOR;
+extern bool petscvector::PETSC_INITIALIZED;
+
+int main( int argc, char *argv[] )
+{
+	DEBUG_MODE_PETSCVECTOR = 0;
+
+	int n = 5;
+	const int k = 3;
+
+	PetscInitialize(&argc,&argv,PETSC_NULL,PETSC_NULL);
+	petscvector::PETSC_INITIALIZED = true;
+	
+    // allocate storage
+    PetscVector H(n);
+
+    // initialize input vector
+    H(0) = 3;
+    H(1) = 4;
+    H(2) = 0;
+    H(3) = 8;
+    H(4) = 2;
+
+	// columns share one array, they are used in combinations like other vectors
+	PetscMultiVector X(H, k);
+	X(0) = H;
+	X(1) = 2*H + 1.0;
+	X(2) = X(0) + X(1);
+	X(2)(1) = 5;
+
+    std::cout << "columns:   " << X.get_columns() << ", size " << X.size() << std::endl;
+    std::cout << "X(0):" << X(0) << std::endl;
+    std::cout << "X(1):" << X(1) << std::endl;
+    std::cout << "X(2):" << X(2) << std::endl;
+
+	// all dot products and norms are computed with one global communication
+	double dots[k], norms[k];
+	X.mdot(H, dots);
+	X.norms(norms);
+	for(int j=0; j < k; j++){
+	    std::cout << "dot(X(" << j << "),H): " << dots[j] << " (" << dot(X(j),H) << ")" << std::endl;
+	    std::cout << "norm(X(" << j << ")): " << norms[j] << " (" << norm(X(j)) << ")" << std::endl;
+	}
+
+	// y = y + sum{alpha_j*X(j)} in one sweep
+	double alpha[k] = {1, -1, 0.5};
+	PetscVector Y(H);
+	Y = 0;
+	X.maxpy(Y, alpha);
+	PetscVector Z(H);
+	Z = 1*X(0) - 1*X(1) + 0.5*X(2);
+    std::cout << "maxpy:" << Y << std::endl;
+    std::cout << "comb: " << Z << std::endl;
+
+	// X(j) = X(j) + alpha_j*H in one sweep
+	X.axpy(alpha, H);
+    std::cout << "axpy X(0):" << X(0) << std::endl;
+    std::cout << "axpy X(1):" << X(1) << std::endl;
+    std::cout << "axpy X(2):" << X(2) << std::endl;
+
+	petscvector::PETSC_INITIALIZED = false;
+	PetscFinalize();
+
+	return 0;
+}
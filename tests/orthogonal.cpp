@@ -0,0 +1,82 @@
+#include "petscvector.h"
+
+using namespace petscvector;
+
+extern int petscvector::DEBUG_MODE_PETSCVECTOR;
+extern bool petscvector::PETSC_INITIALIZED;
+
+/* the values which should be zero are printed without rounding errors (and without sign) */
+double rounded(double value){
+	return std::round(value*1e10)/1e10 + 0.0;
+}
+
+int main( int argc, char *argv[] )
+{
+	DEBUG_MODE_PETSCVECTOR = 0;
+
+	int n = 5;
+
+	PetscInitialize(&argc,&argv,PETSC_NULL,PETSC_NULL);
+	petscvector::PETSC_INITIALIZED = true;
+	
+    // allocate storage
+    PetscVector H(n);
+    PetscVector D(H);
+    PetscVector E(H);
+
+    // initialize input vectors
+    H(0) = 3;  D(0) = 6;  E(0) = 1;
+    H(1) = 4;  D(1) = 7;  E(1) = 0;
+    H(2) = 0;  D(2) = 2;  E(2) = 5;
+    H(3) = 8;  D(3) = 1;  E(3) = 1;
+    H(4) = 2;  D(4) = 8;  E(4) = 3;
+
+	// V = Q*R, the vectors are replaced by orthonormal Q
+	PetscVector Q0(H), Q1(D), Q2(E);
+	PetscVector *q[3] = {&Q0, &Q1, &Q2};
+	double r[3*3], g[3*3];
+	tsqr(3, q, r);
+	gram(3, q, g);
+	for(int j=0; j < 3; j++){
+		for(int i=0; i < 3; i++){
+		    std::cout << "tsqr gram(Q)(" << i << "," << j << "): " << rounded(g[i+3*j]) << std::endl;
+		}
+	}
+
+	PetscVector QR(H);
+	QR = r[0+3*0]*Q0 - H;
+    std::cout << "norm(Q*R(:,0) - H): " << rounded(norm(QR)) << std::endl;
+	QR = r[0+3*1]*Q0 + r[1+3*1]*Q1 - D;
+    std::cout << "norm(Q*R(:,1) - D): " << rounded(norm(QR)) << std::endl;
+	QR = r[0+3*2]*Q0 + r[1+3*2]*Q1 + r[2+3*2]*Q2 - E;
+    std::cout << "norm(Q*R(:,2) - E): " << rounded(norm(QR)) << std::endl;
+
+	// E is orthogonalized against first two columns of Q, E = Q*R + V
+	const PetscVector *basis[2] = {&Q0, &Q1};
+	PetscVector V(E);
+	PetscVector *v[1] = {&V};
+	double rv[2];
+	cgs2(2, basis, 1, v, rv);
+    std::cout << "cgs2 R: " << rv[0] << ", " << rv[1] << " (" << r[0+3*2] << ", " << r[1+3*2] << ")" << std::endl;
+    std::cout << "dot(Q0,V): " << rounded(dot(Q0,V)) << std::endl;
+    std::cout << "dot(Q1,V): " << rounded(dot(Q1,V)) << std::endl;
+	QR = rv[0]*Q0 + rv[1]*Q1 + V - E;
+    std::cout << "norm(Q*R + V - E): " << rounded(norm(QR)) << std::endl;
+
+	// the same with columns of multivectors
+	PetscMultiVector QM(H, 2), VM(H, 1);
+	QM(0) = H; QM(1) = D;
+	VM(0) = E;
+	tsqr(QM, r);
+	cgs2(QM, VM, rv);
+	gram(QM, g);
+    std::cout << "multivector gram(Q): " << rounded(g[0]) << ", " << rounded(g[1]) << ", " << rounded(g[3]) << std::endl;
+    std::cout << "multivector dot(Q,V): " << rounded(dot(QM(0),VM(0))) << ", " << rounded(dot(QM(1),VM(0))) << std::endl;
+	QR = rv[0]*QM(0) + rv[1]*QM(1) + VM(0) - E;
+    std::cout << "multivector norm(Q*R + V - E): " << rounded(norm(QR)) << std::endl;
+
+	petscvector::PETSC_INITIALIZED = false;
+	PetscFinalize();
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include "petscvector.h"
+#include <fstream>
+
+using namespace petscvector;
+
+extern int petscvector::DEBUG_MODE_PETSCVECTOR;
+extern bool petscvector::PETSC_INITIALIZED;
+
+int main( int argc, char *argv[] )
+{
+	DEBUG_MODE_PETSCVECTOR = 0;
+
+	int n = 5;
+
+	PetscInitialize(&argc,&argv,PETSC_NULL,PETSC_NULL);
+	petscvector::PETSC_INITIALIZED = true;
+
+	int rank;
+	MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+	
+    // allocate storage
+    PetscVector H(n);
+
+    // initialize input vector
+    H(0) = 3;
+    H(1) = 4;
+    H(2) = 0;
+    H(3) = 8;
+    H(4) = 2;
+
+	// the whole vector is printed in global order only by the first process
+	if(rank == 0) std::cout << "H:";
+	H.print(std::cout);
+	if(rank == 0) std::cout << std::endl;
+
+	// two first and one last components
+	if(rank == 0) std::cout << "head and tail:";
+	H.print(std::cout, 2, 1);
+	if(rank == 0) std::cout << std::endl;
+
+	H.print_summary(std::cout, 3);
+	if(rank == 0) std::cout << std::endl;
+
+	// every process writes its own lines
+	H.save_ascii_parallel("H.txt");
+	if(rank == 0){
+		std::ifstream file("H.txt");
+		double value;
+		std::cout << "H.txt:";
+		while(file >> value){
+			std::cout << " " << value;
+		}
+		std::cout << std::endl;
+	}
+
+	petscvector::PETSC_INITIALIZED = false;
+	PetscFinalize();
+
+	return 0;
+}
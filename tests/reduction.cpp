@@ -0,0 +1,52 @@
+#include "petscvector.h"
+
+using namespace petscvector;
+
+extern int petscvector::DEBUG_MODE_PETSCVECTOR;
+extern bool petscvector::PETSC_INITIALIZED;
+
+int main( int argc, char *argv[] )
+{
+	DEBUG_MODE_PETSCVECTOR = 0;
+
+	int n = 5;
+
+	PetscInitialize(&argc,&argv,PETSC_NULL,PETSC_NULL);
+	petscvector::PETSC_INITIALIZED = true;
+	
+    // allocate storage
+    PetscVector H(n);
+    PetscVector D(H);
+
+    // initialize input vectors
+    H(0) = 3;  D(0) = 6;
+    H(1) = 4;  D(1) = 7;
+    H(2) = 0;  D(2) = 2;
+    H(3) = 8;  D(3) = 1;
+    H(4) = 2;  D(4) = 8;
+
+	// all reductions are computed with one global communication
+	double dot_HD, norm_H, sum_D, max_H;
+	PetscVectorReduction reduction;
+	reduction.dot(H,D,&dot_HD);
+	reduction.norm(H,&norm_H);
+	reduction.sum(D,&sum_D);
+	reduction.max(H,&max_H);
+	reduction.compute();
+
+    std::cout << "dot(H,D):  " << dot_HD << " (" << dot(H,D) << ")" << std::endl;
+    std::cout << "norm(H):   " << norm_H << " (" << norm(H) << ")" << std::endl;
+    std::cout << "sum(D):    " << sum_D << " (" << sum(D) << ")" << std::endl;
+    std::cout << "max(H):    " << max_H << " (" << max(H) << ")" << std::endl;
+
+	// the reduction is in progress during the update of vector
+	PetscVectorFuture future_norm = norm_async(D);
+	H += 2*D;
+    std::cout << "norm(D):   " << future_norm.get() << " (" << norm(D) << ")" << std::endl;
+    std::cout << "H:" << H << std::endl;
+
+	petscvector::PETSC_INITIALIZED = false;
+	PetscFinalize();
+
+	return 0;
+}